@@ -16,6 +16,22 @@ DEBUG    = -O0 -ggdb -pg -D__DEBUG__ -D__DEBUG_GUI__ -DMALLOC_CHECK_=1
 LIBS     = `libgcrypt-config --libs` -lpthread -lcurl -llzma
 GUILIBS  = `pkg-config --libs gtk+-3.0 gmodule-2.0`
 
+# optional compression algorithms (xz is always available)
+ifneq ($(shell pkg-config --exists libzstd && echo yes),)
+	CPPFLAGS += -DHAVE_ZSTD
+	LIBS     += `pkg-config --libs libzstd`
+endif
+ifneq ($(shell pkg-config --exists liblz4 && echo yes),)
+	CPPFLAGS += -DHAVE_LZ4
+	LIBS     += `pkg-config --libs liblz4`
+endif
+
+# optional asynchronous IO (Linux only)
+ifneq ($(shell pkg-config --exists liburing && echo yes),)
+	CPPFLAGS += -DHAVE_LIBURING
+	LIBS     += `pkg-config --libs liburing`
+endif
+
 all: gui language man
 
 cli: link
@@ -9,7 +9,7 @@ _encrypt()
 		  -k --key -p --password \
 		  -q --quiet -d --debug"
 
-	[ "$1" == "encrypt" ] && opts="$opts -c --cipher -s --hash -x --no-compress"
+	[ "$1" == "encrypt" ] && opts="$opts -c --cipher -s --hash -x --no-compress -z --compressor -e --ecc"
 
 	if [[ "${cur}" == -* ]]
 	then
@@ -30,7 +30,13 @@ _encrypt()
 			-m|--mode)
 				COMPREPLY=($(compgen -W "list $(encrypt -m list 2>&1 | tr '[A-Z]' '[a-z]')" -- "${cur}"))
 				;;
-			-p|--password|-x|--no-compress|-g|--no-gui|-f|--follow|-b|--back-compat|-r|--raw)
+			-z|--compressor)
+				COMPREPLY=($(compgen -W "list $(encrypt -z list 2>&1)" -- "${cur}"))
+				;;
+			-e|--ecc)
+				COMPREPLY=($(compgen -W "rs interleaved off" -- "${cur}"))
+				;;
+			-p|--password|-x|--no-compress|-L|--compress-level|-g|--no-gui|-f|--follow|-b|--back-compat|-r|--raw|-B|--io-buffer|-t|--threads|-X|--xz-block|-M|--xz-memlimit|-P|--pipeline|-U|--io-uring|-C|--drop-cache|-D|--direct|-O|--mmap|-R|--range|-T|--list|-E|--extract|-W|--look-ahead|-w|--write-behind|-S|--scrub)
 				;;
 			*)
 				COMPREPLY=($(compgen -A file -- "${cur}"))
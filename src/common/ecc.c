@@ -32,8 +32,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include <inttypes.h>
+#include <pthread.h>
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+	#include <immintrin.h>
+	#define ECC_X86
+#endif
 
 #include "ecc.h"
 
@@ -47,15 +54,6 @@
 /* Exponentiation. Convert to exponential notation, mod ECC_CAPACITY */
 #define GF_EXP(A, B) ((A) == 0 ? 0 : e2v[(v2e[A] * (B)) % ECC_CAPACITY])
 
-#define REVERSE(A, L)                                                   \
-	for (int i = 0, j = (L) - 1; i < (L) / 2; i++, j--)             \
-	{                                                               \
-		A[i] ^= A[j];                                           \
-		A[j] ^= A[i];                                           \
-		A[i] ^= A[j];                                           \
-	}
-
-
 static const uint8_t g[ECC_OFFSET] = { 0x75, 0x31, 0x3A, 0x9E, 0x04, 0x7E };
 
 static const uint8_t e2v[ECC_CAPACITY + 1] =
@@ -99,15 +97,56 @@ static const uint8_t v2e[ECC_CAPACITY + 1] =
 };
 
 
+#define ECC_REGISTER 0xFFFFFFFFFFFFULL /* the bytes of a uint64_t the register uses */
+#define ECC_HORNER 7                   /* steps of α^i, α^2i, α^4i … α^64i the syndromes are evaluated with */
+
+static uint64_t slice[ECC_OFFSET][0x100];               /* the register after 6 steps, from each byte of it on its own */
+static uint8_t nibble[ECC_OFFSET][2][0x10];             /* products of each term of the generator with every low, and high, nibble */
+static uint64_t affine[ECC_OFFSET];                     /* the same products, as bit matrices */
+static uint8_t horner[ECC_HORNER][ECC_OFFSET][2][0x10]; /* products of each step of each syndrome with every low, and high, nibble */
+static uint64_t horner_affine[ECC_HORNER][ECC_OFFSET];  /* the same products, as bit matrices */
+static void (*encode_lanes)(const uint8_t *, uint8_t *, size_t) = NULL;
+static size_t lanes = 0;                                /* how many payloads encode_lanes() does at once */
+static bool (*check)(const uint8_t *) = NULL;           /* whether a codeword is free of errors */
+static pthread_once_t ecc_once = PTHREAD_ONCE_INIT;
+
+static void ecc_init(void);
+static void multiplier(uint8_t, uint8_t [2][0x10], uint64_t *);
+static uint64_t parity(const uint8_t *);
+static void encode_one(const uint8_t *, uint8_t *);
+static bool check_one(const uint8_t *);
+#ifdef ECC_X86
+static void encode_ssse3(const uint8_t *, uint8_t *, size_t);
+static void encode_avx2(const uint8_t *, uint8_t *, size_t);
+static void encode_gfni(const uint8_t *, uint8_t *, size_t);
+static void encode_parity(const uint8_t *, uint8_t *, size_t, size_t, uint8_t [ECC_OFFSET][0x40]);
+static bool check_avx2(const uint8_t *);
+static bool check_gfni(const uint8_t *);
+
+/*
+ * after transposing 16×16 bytes by unpacking pairs of rows, which
+ * column ends up in which row
+ */
+static const uint8_t TRANSPOSED[0x10] = { 0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF };
+
+#define TRANSPOSE(Y, X, LO, HI)                                         \
+	for (int i = 0; i < 8; i++)                                     \
+	{                                                               \
+		Y[i] = LO(X[2 * i], X[2 * i + 1]);                      \
+		Y[i + 8] = HI(X[2 * i], X[2 * i + 1]);                  \
+	}
+#endif
+
+
 /*
- * Polynomial Evaluator, used to determine the Syndrome Vector. This is
- * relatively straightforward, and there are faster algorithms.
+ * Polynomial Evaluator, used to determine the Syndrome Vector. The code
+ * is in order, highest power first, so this is Horner's rule.
  */
-static uint8_t evalpoly(uint8_t p[ECC_CAPACITY], uint8_t x)
+static uint8_t evalpoly(const uint8_t p[ECC_CAPACITY], uint8_t x)
 {
 	uint8_t y = 0;
 	for (int i = 0; i < ECC_CAPACITY; i++)
-		y = GF_ADD(y, GF_MUL(p[i], GF_EXP(x, i)));
+		y = GF_ADD(GF_MUL(y, x), p[i]);
 	return y;
 }
 
@@ -116,7 +155,7 @@ static uint8_t evalpoly(uint8_t p[ECC_CAPACITY], uint8_t x)
  * all of the syndromes; this allows for an easy check for the no - error
  * condition.
  */
-static void syndrome(uint8_t c[ECC_CAPACITY], uint8_t s[7])
+static void syndrome(const uint8_t c[ECC_CAPACITY], uint8_t s[7])
 {
 	s[0] = 0;
 	for (int i = 1; i < ECC_OFFSET + 1; i++)
@@ -182,7 +221,7 @@ static void polysolve(uint8_t polynom[4], uint8_t roots[3], int *numsol)
  */
 extern void ecc_decode(uint8_t code[ECC_CAPACITY], uint8_t mesg[ECC_CAPACITY], int *errcode)
 {
-	REVERSE(code, ECC_CAPACITY);
+	pthread_once(&ecc_once, ecc_init);
 
 	uint8_t syn[ECC_OFFSET + 1], deter, z[4], e0, e1, e2, n0, n1, n2, w0, w1, w2, x0, x[3];
 	int sols;
@@ -193,8 +232,15 @@ extern void ecc_decode(uint8_t code[ECC_CAPACITY], uint8_t mesg[ECC_CAPACITY], i
 	 * First, get the message out of the code, so that even if we can't correct
 	 * it, we return an estimate.
 	 */
-	for (int i = 0; i < ECC_PAYLOAD; i++)
-		mesg[i] = code[(ECC_CAPACITY - 1) - i];
+	if (mesg != code)
+		memcpy(mesg, code, ECC_PAYLOAD);
+
+	/*
+	 * Almost every block is fine, which can be found out quickly; only
+	 * if it isn't are the syndromes themselves needed.
+	 */
+	if (check(code))
+		return;
 
 	syndrome(code, syn);
 
@@ -313,21 +359,363 @@ extern void ecc_decode(uint8_t code[ECC_CAPACITY], uint8_t mesg[ECC_CAPACITY], i
  * Note that the message is reversed in the code array; this was done to
  * allow for (emergency) recovery of the message directly from the
  * data stream.
+ *
+ * The register is 6 bytes, so it fits in a uint64_t (r[j] in byte j);
+ * each step shifts it up a byte and, as everything is linear, adds in
+ * a product of the generator which can be looked up. Better still, 6
+ * message bytes can be added in at once, and then 6 lookups (one for
+ * each byte of the register) give the register 6 steps later (as with
+ * a slicing CRC). Given several payloads, each of which is independent
+ * of the others, the x86 versions run one step of 16, 32 or 64 of them
+ * at once, multiplying by the generator with PSHUFB (a nibble at a
+ * time) or GFNI.
  */
 extern void ecc_encode(uint8_t m[ECC_PAYLOAD], uint8_t c[ECC_CAPACITY])
 {
-	uint8_t r[ECC_OFFSET] = { 0x0 };
+	pthread_once(&ecc_once, ecc_init);
+	encode_one(m, c);
+}
+
+extern void ecc_encode_batch(const uint8_t *m, uint8_t *c, size_t n, size_t s)
+{
+	pthread_once(&ecc_once, ecc_init);
+	size_t i = 0;
+	if (encode_lanes)
+		for (; i + lanes <= n; i += lanes)
+			encode_lanes(m + i * ECC_PAYLOAD, c + i * s, s);
+	for (; i < n; i++)
+		encode_one(m + i * ECC_PAYLOAD, c + i * s);
+}
+
+static void ecc_init(void)
+{
+	uint64_t step[0x100];
+	for (int t = 0; t < 0x100; t++)
+	{
+		step[t] = 0;
+		for (int j = 0; j < ECC_OFFSET; j++)
+			step[t] |= (uint64_t)GF_MUL(t, g[j]) << (8 * j);
+	}
+	for (int k = 0; k < ECC_OFFSET; k++)
+		for (int b = 0; b < 0x100; b++)
+		{
+			uint64_t r = (uint64_t)b << (8 * (ECC_OFFSET - 1 - k));
+			for (int i = 0; i < ECC_OFFSET; i++)
+				r = (r << 8 & ECC_REGISTER) ^ step[r >> 40];
+			slice[k][b] = r;
+		}
+	for (int j = 0; j < ECC_OFFSET; j++)
+		multiplier(g[j], nibble[j], &affine[j]);
+	for (int e = 0; e < ECC_HORNER; e++)
+		for (int i = 0; i < ECC_OFFSET; i++)
+			multiplier(e2v[((i + 1) << e) % ECC_CAPACITY], horner[e][i], &horner_affine[e][i]);
+	check = check_one;
+#ifdef ECC_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("gfni"))
+		encode_lanes = encode_gfni , lanes = 0x40 , check = check_gfni;
+	else if (__builtin_cpu_supports("avx2"))
+		encode_lanes = encode_avx2 , lanes = 0x20 , check = check_avx2;
+	else if (__builtin_cpu_supports("ssse3"))
+		encode_lanes = encode_ssse3 , lanes = 0x10;
+#endif
+	return;
+}
+
+/*
+ * products of x with every low, and high, nibble, and the bit matrix
+ * which multiplies by it (bit i of each product comes from byte 7 - i)
+ */
+static void multiplier(uint8_t x, uint8_t n[2][0x10], uint64_t *a)
+{
+	for (int i = 0; i < 0x10; i++)
+	{
+		n[0][i] = GF_MUL(i, x);
+		n[1][i] = GF_MUL(i << 4, x);
+	}
+	*a = 0;
+	for (int i = 0; i < 8; i++)
+		for (int b = 0; b < 8; b++)
+			if (GF_MUL(1 << b, x) >> i & 1)
+				*a |= 1ULL << (8 * (7 - i) + b);
+	return;
+}
+
+static uint64_t parity(const uint8_t *m)
+{
+	uint64_t r = 0;
+	int i = 0;
+	for (; i + ECC_OFFSET <= ECC_PAYLOAD; i += ECC_OFFSET)
+	{
+		r ^= (uint64_t)m[i] << 40 | (uint64_t)m[i + 1] << 32 | (uint64_t)m[i + 2] << 24 | (uint64_t)m[i + 3] << 16 | (uint64_t)m[i + 4] << 8 | m[i + 5];
+		r = slice[0][r >> 40] ^ slice[1][r >> 32 & 0xFF] ^ slice[2][r >> 24 & 0xFF] ^ slice[3][r >> 16 & 0xFF] ^ slice[4][r >> 8 & 0xFF] ^ slice[5][r & 0xFF];
+	}
+	for (; i < ECC_PAYLOAD; i++)
+		r = (r << 8 & ECC_REGISTER) ^ slice[ECC_OFFSET - 1][(r >> 40 ^ m[i]) & 0xFF];
+	return r;
+}
+
+static void encode_one(const uint8_t *m, uint8_t *c)
+{
+	uint64_t r = parity(m);
+	memcpy(c, m, ECC_PAYLOAD);
+	for (int j = 0; j < ECC_OFFSET; j++)
+		c[ECC_PAYLOAD + j] = r >> (8 * (ECC_OFFSET - 1 - j));
+}
 
-	for (int i = 0; i < ECC_PAYLOAD; i++)
+/*
+ * the syndromes are all zero when (and only when) the codeword is a
+ * multiple of the generator, which is to say its parity is what the
+ * payload would be encoded with
+ */
+static bool check_one(const uint8_t *c)
+{
+	uint64_t r = parity(c);
+	for (int j = 0; j < ECC_OFFSET; j++)
+		if (c[ECC_PAYLOAD + j] != (uint8_t)(r >> (8 * (ECC_OFFSET - 1 - j))))
+			return false;
+	return true;
+}
+
+#ifdef ECC_X86
+__attribute__((target("ssse3")))
+static void encode_ssse3(const uint8_t *m, uint8_t *c, size_t s)
+{
+	const __m128i f = _mm_set1_epi8(0x0F);
+	__m128i lo[ECC_OFFSET], hi[ECC_OFFSET], r[ECC_OFFSET];
+	for (int j = 0; j < ECC_OFFSET; j++)
+	{
+		lo[j] = _mm_loadu_si128((const __m128i *)nibble[j][0]);
+		hi[j] = _mm_loadu_si128((const __m128i *)nibble[j][1]);
+		r[j] = _mm_setzero_si128();
+	}
+	for (int b = 0; b < ECC_PAYLOAD; b += 0x10)
 	{
-		c[(ECC_CAPACITY - 1) - i] = m[i];
-		uint8_t rtmp = GF_ADD(m[i], r[5]);
-		for (int j = ECC_OFFSET - 1; j > 0; j--)
-			r[j] = GF_ADD(GF_MUL(rtmp, g[j]), r[j - 1]);
-		r[0] = GF_MUL(rtmp, g[0]);
+		/*
+		 * 16 bytes of each payload, turned so that each vector
+		 * holds the same byte of all of them (the end of the
+		 * last payload is copied, so as not to read beyond it)
+		 */
+		__m128i x[0x10], y[0x10];
+		uint8_t t[0x10] = { 0x0 };
+		for (int i = 0; i < 0x10; i++)
+			if (b + 0x10 <= ECC_PAYLOAD)
+				x[i] = _mm_loadu_si128((const __m128i *)(m + i * ECC_PAYLOAD + b));
+			else
+				memcpy(t, m + i * ECC_PAYLOAD + b, ECC_PAYLOAD - b) , x[i] = _mm_loadu_si128((const __m128i *)t);
+		TRANSPOSE(y, x, _mm_unpacklo_epi8, _mm_unpackhi_epi8);
+		TRANSPOSE(x, y, _mm_unpacklo_epi16, _mm_unpackhi_epi16);
+		TRANSPOSE(y, x, _mm_unpacklo_epi32, _mm_unpackhi_epi32);
+		TRANSPOSE(x, y, _mm_unpacklo_epi64, _mm_unpackhi_epi64);
+		for (int p = 0; p < 0x10 && b + p < ECC_PAYLOAD; p++)
+		{
+			__m128i v = _mm_xor_si128(x[TRANSPOSED[p]], r[ECC_OFFSET - 1]);
+			__m128i vl = _mm_and_si128(v, f);
+			__m128i vh = _mm_and_si128(_mm_srli_epi16(v, 4), f);
+			for (int j = ECC_OFFSET - 1; j > 0; j--)
+				r[j] = _mm_xor_si128(r[j - 1], _mm_xor_si128(_mm_shuffle_epi8(lo[j], vl), _mm_shuffle_epi8(hi[j], vh)));
+			r[0] = _mm_xor_si128(_mm_shuffle_epi8(lo[0], vl), _mm_shuffle_epi8(hi[0], vh));
+		}
 	}
+	uint8_t q[ECC_OFFSET][0x40];
+	for (int j = 0; j < ECC_OFFSET; j++)
+		_mm_storeu_si128((__m128i *)q[j], r[j]);
+	encode_parity(m, c, s, 0x10, q);
+}
+
+__attribute__((target("avx2")))
+static void encode_avx2(const uint8_t *m, uint8_t *c, size_t s)
+{
+	/*
+	 * as above, but with payloads 16 to 31 in the upper half of
+	 * each vector (which PSHUFB and unpacking keep to themselves)
+	 */
+	const __m256i f = _mm256_set1_epi8(0x0F);
+	__m256i lo[ECC_OFFSET], hi[ECC_OFFSET], r[ECC_OFFSET];
+	for (int j = 0; j < ECC_OFFSET; j++)
+	{
+		lo[j] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)nibble[j][0]));
+		hi[j] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)nibble[j][1]));
+		r[j] = _mm256_setzero_si256();
+	}
+	for (int b = 0; b < ECC_PAYLOAD; b += 0x10)
+	{
+		__m256i x[0x10], y[0x10];
+		uint8_t t[2][0x10] = { { 0x0 } };
+		for (int i = 0; i < 0x10; i++)
+			if (b + 0x10 <= ECC_PAYLOAD)
+				x[i] = _mm256_loadu2_m128i((const __m128i *)(m + (i + 0x10) * ECC_PAYLOAD + b), (const __m128i *)(m + i * ECC_PAYLOAD + b));
+			else
+			{
+				memcpy(t[0], m + i * ECC_PAYLOAD + b, ECC_PAYLOAD - b);
+				memcpy(t[1], m + (i + 0x10) * ECC_PAYLOAD + b, ECC_PAYLOAD - b);
+				x[i] = _mm256_loadu2_m128i((const __m128i *)t[1], (const __m128i *)t[0]);
+			}
+		TRANSPOSE(y, x, _mm256_unpacklo_epi8, _mm256_unpackhi_epi8);
+		TRANSPOSE(x, y, _mm256_unpacklo_epi16, _mm256_unpackhi_epi16);
+		TRANSPOSE(y, x, _mm256_unpacklo_epi32, _mm256_unpackhi_epi32);
+		TRANSPOSE(x, y, _mm256_unpacklo_epi64, _mm256_unpackhi_epi64);
+		for (int p = 0; p < 0x10 && b + p < ECC_PAYLOAD; p++)
+		{
+			__m256i v = _mm256_xor_si256(x[TRANSPOSED[p]], r[ECC_OFFSET - 1]);
+			__m256i vl = _mm256_and_si256(v, f);
+			__m256i vh = _mm256_and_si256(_mm256_srli_epi16(v, 4), f);
+			for (int j = ECC_OFFSET - 1; j > 0; j--)
+				r[j] = _mm256_xor_si256(r[j - 1], _mm256_xor_si256(_mm256_shuffle_epi8(lo[j], vl), _mm256_shuffle_epi8(hi[j], vh)));
+			r[0] = _mm256_xor_si256(_mm256_shuffle_epi8(lo[0], vl), _mm256_shuffle_epi8(hi[0], vh));
+		}
+	}
+	uint8_t q[ECC_OFFSET][0x40];
+	for (int j = 0; j < ECC_OFFSET; j++)
+		_mm256_storeu_si256((__m256i *)q[j], r[j]);
+	encode_parity(m, c, s, 0x20, q);
+}
+
+__attribute__((target("avx512f,avx512bw,gfni")))
+static void encode_gfni(const uint8_t *m, uint8_t *c, size_t s)
+{
+	/*
+	 * four groups of 16 payloads, and each product is a single
+	 * affine transformation
+	 */
+	__m512i a[ECC_OFFSET], r[ECC_OFFSET];
+	for (int j = 0; j < ECC_OFFSET; j++)
+	{
+		a[j] = _mm512_set1_epi64(affine[j]);
+		r[j] = _mm512_setzero_si512();
+	}
+	for (int b = 0; b < ECC_PAYLOAD; b += 0x10)
+	{
+		__m512i x[0x10], y[0x10];
+		uint8_t t[4][0x10] = { { 0x0 } };
+		for (int i = 0; i < 0x10; i++)
+		{
+			__m128i w[4];
+			for (int k = 0; k < 4; k++)
+				if (b + 0x10 <= ECC_PAYLOAD)
+					w[k] = _mm_loadu_si128((const __m128i *)(m + (i + 0x10 * k) * ECC_PAYLOAD + b));
+				else
+					memcpy(t[k], m + (i + 0x10 * k) * ECC_PAYLOAD + b, ECC_PAYLOAD - b) , w[k] = _mm_loadu_si128((const __m128i *)t[k]);
+			x[i] = _mm512_inserti32x4(_mm512_inserti32x4(_mm512_inserti32x4(_mm512_castsi128_si512(w[0]), w[1], 1), w[2], 2), w[3], 3);
+		}
+		TRANSPOSE(y, x, _mm512_unpacklo_epi8, _mm512_unpackhi_epi8);
+		TRANSPOSE(x, y, _mm512_unpacklo_epi16, _mm512_unpackhi_epi16);
+		TRANSPOSE(y, x, _mm512_unpacklo_epi32, _mm512_unpackhi_epi32);
+		TRANSPOSE(x, y, _mm512_unpacklo_epi64, _mm512_unpackhi_epi64);
+		for (int p = 0; p < 0x10 && b + p < ECC_PAYLOAD; p++)
+		{
+			__m512i v = _mm512_xor_si512(x[TRANSPOSED[p]], r[ECC_OFFSET - 1]);
+			for (int j = ECC_OFFSET - 1; j > 0; j--)
+				r[j] = _mm512_xor_si512(r[j - 1], _mm512_gf2p8affine_epi64_epi8(v, a[j], 0));
+			r[0] = _mm512_gf2p8affine_epi64_epi8(v, a[0], 0);
+		}
+	}
+	uint8_t q[ECC_OFFSET][0x40];
+	for (int j = 0; j < ECC_OFFSET; j++)
+		_mm512_storeu_si512(q[j], r[j]);
+	encode_parity(m, c, s, 0x40, q);
+}
+
+/*
+ * the payloads, each followed by its parity (byte k of each vector of
+ * the register is that of payload k)
+ */
+static void encode_parity(const uint8_t *m, uint8_t *c, size_t s, size_t n, uint8_t q[ECC_OFFSET][0x40])
+{
+	for (size_t k = 0; k < n; k++)
+	{
+		memcpy(c + k * s, m + k * ECC_PAYLOAD, ECC_PAYLOAD);
+		for (int j = 0; j < ECC_OFFSET; j++)
+			c[k * s + ECC_PAYLOAD + j] = q[ECC_OFFSET - 1 - j][k];
+	}
+}
+
+/*
+ * A codeword is checked on its own, so each vector holds consecutive
+ * bytes of it: taking W at a time, lane k sums those at k, k + W, …
+ * by Horner's rule (stepping by α^(iW) for syndrome i); the lanes are
+ * then folded in half, and in half again (stepping by α^(iW/2) …) until
+ * the first holds the lot. A zero after the codeword makes it a round
+ * 256 bytes, which only multiplies each syndrome by α^i. (With only 16
+ * lanes this is no quicker than check_one(), so there’s no SSSE3 one.)
+ */
+__attribute__((target("ssse3")))
+static inline __m128i multiply_ssse3(__m128i v, const uint8_t n[2][0x10])
+{
+	const __m128i f = _mm_set1_epi8(0x0F);
+	__m128i l = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)n[0]), _mm_and_si128(v, f));
+	__m128i h = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)n[1]), _mm_and_si128(_mm_srli_epi16(v, 4), f));
+	return _mm_xor_si128(l, h);
+}
+
+__attribute__((target("ssse3")))
+static inline bool fold_ssse3(__m128i v, int i)
+{
+	v = _mm_xor_si128(multiply_ssse3(v, horner[3][i]), _mm_srli_si128(v, 8));
+	v = _mm_xor_si128(multiply_ssse3(v, horner[2][i]), _mm_srli_si128(v, 4));
+	v = _mm_xor_si128(multiply_ssse3(v, horner[1][i]), _mm_srli_si128(v, 2));
+	v = _mm_xor_si128(multiply_ssse3(v, horner[0][i]), _mm_srli_si128(v, 1));
+	return !(_mm_cvtsi128_si32(v) & 0xFF);
+}
+
+__attribute__((target("avx2")))
+static bool check_avx2(const uint8_t *c)
+{
+	const __m256i f = _mm256_set1_epi8(0x0F);
+	uint8_t t[0x20] = { 0x0 };
+	memcpy(t, c + 0xE0, ECC_CAPACITY - 0xE0);
+	__m256i lo[ECC_OFFSET], hi[ECC_OFFSET], s[ECC_OFFSET];
 	for (int i = 0; i < ECC_OFFSET; i++)
-		c[i] = r[i];
+	{
+		lo[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)horner[5][i][0]));
+		hi[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)horner[5][i][1]));
+		s[i] = _mm256_setzero_si256();
+	}
+	for (int b = 0; b < 0x100; b += 0x20)
+	{
+		__m256i x = _mm256_loadu_si256((const __m256i *)(b < 0xE0 ? c + b : t));
+		for (int i = 0; i < ECC_OFFSET; i++)
+		{
+			__m256i l = _mm256_shuffle_epi8(lo[i], _mm256_and_si256(s[i], f));
+			__m256i h = _mm256_shuffle_epi8(hi[i], _mm256_and_si256(_mm256_srli_epi16(s[i], 4), f));
+			s[i] = _mm256_xor_si256(_mm256_xor_si256(l, h), x);
+		}
+	}
+	for (int i = 0; i < ECC_OFFSET; i++)
+		if (!fold_ssse3(_mm_xor_si128(multiply_ssse3(_mm256_castsi256_si128(s[i]), horner[4][i]), _mm256_extracti128_si256(s[i], 1)), i))
+			return false;
+	return true;
+}
 
-	REVERSE(c, ECC_CAPACITY);
+__attribute__((target("avx512f,avx512bw,gfni")))
+static bool check_gfni(const uint8_t *c)
+{
+	__m512i a[ECC_OFFSET], s[ECC_OFFSET];
+	for (int i = 0; i < ECC_OFFSET; i++)
+	{
+		a[i] = _mm512_set1_epi64(horner_affine[6][i]);
+		s[i] = _mm512_setzero_si512();
+	}
+	for (int b = 0; b < 0x100; b += 0x40)
+	{
+		/*
+		 * the last block is masked, rather than copied
+		 */
+		__m512i x = b < 0xC0 ? _mm512_loadu_si512(c + b) : _mm512_maskz_loadu_epi8(0x7FFFFFFFFFFFFFFFULL, c + b);
+		for (int i = 0; i < ECC_OFFSET; i++)
+			s[i] = _mm512_xor_si512(_mm512_gf2p8affine_epi64_epi8(s[i], a[i], 0), x);
+	}
+	for (int i = 0; i < ECC_OFFSET; i++)
+	{
+		__m256i w = _mm256_xor_si256(_mm256_gf2p8affine_epi64_epi8(_mm512_castsi512_si256(s[i]), _mm256_set1_epi64x(horner_affine[5][i]), 0), _mm512_extracti64x4_epi64(s[i], 1));
+		__m128i v = _mm_xor_si128(_mm_gf2p8affine_epi64_epi8(_mm256_castsi256_si128(w), _mm_set1_epi64x(horner_affine[4][i]), 0), _mm256_extracti128_si256(w, 1));
+		v = _mm_xor_si128(_mm_gf2p8affine_epi64_epi8(v, _mm_set1_epi64x(horner_affine[3][i]), 0), _mm_srli_si128(v, 8));
+		v = _mm_xor_si128(_mm_gf2p8affine_epi64_epi8(v, _mm_set1_epi64x(horner_affine[2][i]), 0), _mm_srli_si128(v, 4));
+		v = _mm_xor_si128(_mm_gf2p8affine_epi64_epi8(v, _mm_set1_epi64x(horner_affine[1][i]), 0), _mm_srli_si128(v, 2));
+		v = _mm_xor_si128(_mm_gf2p8affine_epi64_epi8(v, _mm_set1_epi64x(horner_affine[0][i]), 0), _mm_srli_si128(v, 1));
+		if (_mm_cvtsi128_si32(v) & 0xFF)
+			return false;
+	}
+	return true;
 }
+#endif
@@ -21,6 +21,7 @@
 #ifndef _ECC_H_
 #define _ECC_H_
 
+#include <stddef.h>
 #include <inttypes.h>
 
 /*
@@ -40,6 +41,16 @@
 #define ECC_OFFSET      (ECC_CAPACITY - ECC_PAYLOAD)
 
 extern void ecc_encode(uint8_t m[ECC_PAYLOAD], uint8_t c[ECC_CAPACITY]);
+/*
+ * encode n payloads, one after the other in m, writing each codeword s
+ * bytes after the last in c (which is the same as ecc_encode for each,
+ * only faster)
+ */
+extern void ecc_encode_batch(const uint8_t *m, uint8_t *c, size_t n, size_t s);
+/*
+ * decode (and correct, if need be) a codeword; mesg can be code itself,
+ * which is left alone otherwise
+ */
 extern void ecc_decode(uint8_t code[ECC_CAPACITY], uint8_t mesg[ECC_CAPACITY], int *errcode);
 
 #endif /* _ECC_H_ */
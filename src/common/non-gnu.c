@@ -198,8 +198,12 @@ char *strchrnul(const char *s, int c_in)
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <limits.h>
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <io.h>
+#include <pthread.h>
 
 char *program_invocation_short_name = NULL;
 
@@ -334,6 +338,200 @@ extern FILE *temp_file(void)
 	return t;
 }
 
+/*
+ * the directories opened with openat(), kept against the descriptor
+ * (of NUL) each was given; a descriptor that’s been closed (and maybe
+ * reused for a file) isn’t forgotten until it’s given to another
+ * directory, but *at() is only ever given those still open
+ */
+typedef struct
+{
+	char *path;
+	DIR *dir;
+}
+at_dir_t;
+
+static pthread_mutex_t at_mutex = PTHREAD_MUTEX_INITIALIZER;
+static at_dir_t *at_dir = NULL;
+static size_t at_dirs = 0;
+
+static char *at_path(int at, const char *name)
+{
+	char *p = NULL;
+	pthread_mutex_lock(&at_mutex);
+	if (at == AT_FDCWD)
+		p = strdup(name);
+	else if (at >= 0 && (size_t)at < at_dirs && at_dir[at].path)
+	{
+		if (asprintf(&p, "%s/%s", at_dir[at].path, name) < 0)
+			p = NULL;
+	}
+	else
+		errno = EBADF;
+	pthread_mutex_unlock(&at_mutex);
+	return p;
+}
+
+extern int openat(int at, const char *name, int flags, ...)
+{
+	char *p = at_path(at, name);
+	if (!p)
+		return -1;
+	if (!(flags & O_DIRECTORY))
+	{
+		/*
+		 * (permissions can’t be given on Windows)
+		 */
+		int f = open(p, flags, _S_IREAD | _S_IWRITE);
+		free(p);
+		return f;
+	}
+	struct stat s;
+	if (stat(p, &s))
+		return free(p) , -1;
+	if (!S_ISDIR(s.st_mode))
+		return free(p) , errno = ENOTDIR , -1;
+	int f = open("NUL", O_RDONLY);
+	if (f < 0)
+		return free(p) , -1;
+	pthread_mutex_lock(&at_mutex);
+	if ((size_t)f >= at_dirs)
+	{
+		at_dir_t *x = realloc(at_dir, (f + 1) * sizeof( at_dir_t ));
+		if (!x)
+			die(_("out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, (f + 1) * sizeof( at_dir_t ));
+		memset(x + at_dirs, 0x00, (f + 1 - at_dirs) * sizeof( at_dir_t ));
+		at_dir = x;
+		at_dirs = f + 1;
+	}
+	free(at_dir[f].path);
+	at_dir[f].path = p;
+	at_dir[f].dir = NULL;
+	pthread_mutex_unlock(&at_mutex);
+	return f;
+}
+
+extern int mkdirat(int at, const char *name, mode_t m)
+{
+	(void)m;
+	char *p = at_path(at, name);
+	if (!p)
+		return -1;
+	int r = mkdir(p, m);
+	free(p);
+	return r;
+}
+
+extern int linkat(int from, const char *old, int to, const char *new, int flags)
+{
+	(void)flags;
+	char *o = at_path(from, old);
+	char *n = at_path(to, new);
+	/*
+	 * as with link(), the file is copied
+	 */
+	int r = o && n && CopyFile(o, n, FALSE) ? 0 : -1;
+	free(o);
+	free(n);
+	return r;
+}
+
+extern int fstatat(int at, const char *name, struct stat *st, int flags)
+{
+	(void)flags;
+	char *p = at_path(at, name);
+	if (!p)
+		return -1;
+	int r = stat(p, st);
+	free(p);
+	return r;
+}
+
+extern DIR *fdopendir(int fd)
+{
+	char *p = at_path(fd, ".");
+	if (!p)
+		return NULL;
+	DIR *d = opendir(p);
+	free(p);
+	if (d)
+	{
+		pthread_mutex_lock(&at_mutex);
+		at_dir[fd].dir = d;
+		pthread_mutex_unlock(&at_mutex);
+	}
+	return d;
+}
+
+extern int dirfd(DIR *d)
+{
+	int f = -1;
+	pthread_mutex_lock(&at_mutex);
+	for (size_t i = 0; i < at_dirs && f < 0; i++)
+		if (at_dir[i].dir == d)
+			f = i;
+	pthread_mutex_unlock(&at_mutex);
+	return f < 0 ? errno = EINVAL , -1 : f;
+}
+
+#undef closedir
+
+/*
+ * like closedir() on a directory from fdopendir(), the descriptor is
+ * closed too
+ */
+extern int closedir_at(DIR *d)
+{
+	int f = dirfd(d);
+	if (f >= 0)
+	{
+		pthread_mutex_lock(&at_mutex);
+		at_dir[f].dir = NULL;
+		pthread_mutex_unlock(&at_mutex);
+		close(f);
+	}
+	return closedir(d);
+}
+
+/*
+ * Windows has no pread() or pwrite(), so the descriptor is moved to
+ * where it’s wanted and back again; the lock keeps another of these
+ * from moving it in between
+ */
+static pthread_mutex_t positioned_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+extern ssize_t pread(int fd, void *b, size_t l, off_t o)
+{
+	pthread_mutex_lock(&positioned_mutex);
+	int64_t c = _lseeki64(fd, 0, SEEK_CUR);
+	ssize_t r = -1;
+	if (c >= 0 && _lseeki64(fd, o, SEEK_SET) == o)
+	{
+		r = read(fd, b, l > INT_MAX ? INT_MAX : l);
+		int e = errno;
+		_lseeki64(fd, c, SEEK_SET);
+		errno = e;
+	}
+	pthread_mutex_unlock(&positioned_mutex);
+	return r;
+}
+
+extern ssize_t pwrite(int fd, const void *b, size_t l, off_t o)
+{
+	pthread_mutex_lock(&positioned_mutex);
+	int64_t c = _lseeki64(fd, 0, SEEK_CUR);
+	ssize_t r = -1;
+	if (c >= 0 && _lseeki64(fd, o, SEEK_SET) == o)
+	{
+		r = write(fd, b, l > INT_MAX ? INT_MAX : l);
+		int e = errno;
+		_lseeki64(fd, c, SEEK_SET);
+		errno = e;
+	}
+	pthread_mutex_unlock(&positioned_mutex);
+	return r;
+}
+
 #include <VersionHelpers.h>
 
 extern char *windows_version(void)
@@ -47,6 +47,11 @@
 #define F_RDLCK NOTSET /*!< If value doesn’t exist on Windows, ignore it */
 #define F_WRLCK NOTSET /*!< If value doesn’t exist on Windows, ignore it */
 #define O_FSYNC NOTSET /*!< If value doesn’t exist on Windows, ignore it */
+#define AT_FDCWD -100  /*!< Paths given with this are used as they are */
+
+#define AT_SYMLINK_NOFOLLOW 0x100        /*!< There are no symlinks to follow on Windows, so this is ignored */
+#define O_DIRECTORY         0x01000000   /*!< Not a real flag on Windows; it tells openat() to remember the directory */
+#define closedir(d)         closedir_at(d)
 
 #ifdef S_IRUSR
 	#undef S_IRUSR
@@ -98,6 +103,30 @@ extern int scandir(const char *path, struct dirent ***res, int (*sel)(const stru
 
 extern FILE *temp_file(void);
 
+/*
+ * Windows has no descriptors for directories, so these stand in for
+ * the POSIX *at() functions: a directory opened with openat() (and
+ * O_DIRECTORY) has its path remembered against the descriptor it gets
+ * back, and the path of anything within it is built from that
+ */
+extern int openat(int at, const char *name, int flags, ...) __attribute__((nonnull(2)));
+
+extern int mkdirat(int at, const char *name, mode_t m) __attribute__((nonnull(2)));
+
+extern int linkat(int from, const char *old, int to, const char *new, int flags) __attribute__((nonnull(2, 4)));
+
+extern int fstatat(int at, const char *name, struct stat *st, int flags) __attribute__((nonnull(2, 3)));
+
+extern DIR *fdopendir(int fd);
+
+extern int dirfd(DIR *d) __attribute__((nonnull(1)));
+
+extern int closedir_at(DIR *d) __attribute__((nonnull(1)));
+
+extern ssize_t pread(int fd, void *b, size_t l, off_t o) __attribute__((nonnull(2)));
+
+extern ssize_t pwrite(int fd, const void *b, size_t l, off_t o) __attribute__((nonnull(2)));
+
 extern char *windows_version(void);
 
 #endif /* _WIN32 */
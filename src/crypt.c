@@ -60,7 +60,12 @@ static const char *STATUS_MESSAGE[] =
 	"Failed: Decryption failure! (Invalid password)",
 	"Failed: Unsupported feature!",
 	"Failed: Read/Write error!",
-	"Failed: LZMA decompression error!",
+	"Failed: Decompression error!",
+	"Failed: Data authentication error! (Possible tampering)",
+	"Failed: Range unavailable! (Only for uncompressed files since 2026.10)",
+	"Failed: No table of contents! (Only for directories since 2026.10)",
+	"Failed: No such file in the directory!",
+	"Failed: Only files and links can be extracted! (Not directories)",
 	"Failed: Key generation error!",
 	"Failed: Invalid target file type!",
 	"Failed: An unknown error has occurred!",
@@ -89,7 +94,9 @@ static const version_t VERSIONS[] =
 	{ "2015.10", 0x0dae4a923e4ae71dllu },
 	{ "2017.09", 0x323031372e303921llu },
 	{ "2020.01", 0x323032302e30312ellu },
-	{ "current", 0x323032302e30312ellu }
+	{ "2026.10", 0x323032362e31302ellu },
+	{ "2026.11", 0x323032362e31312ellu },
+	{ "current", 0x323032362e31312ellu }
 };
 
 extern void execute(crypto_t *c)
@@ -123,6 +130,10 @@ extern void deinit(crypto_t **c)
 		gcry_free(z->path);
 	if (z->name)
 		gcry_free(z->name);
+	if (z->extract)
+		free(z->extract);
+	if (z->index)
+		free(z->index);
 	if (z->source)
 		io_close(z->source);
 	if (z->output)
@@ -147,32 +158,37 @@ extern void key_gcry_free(raw_key_t **key)
 
 extern version_e is_encrypted_aux(bool b, const char *n, char **c, char **h, char **m, char **a, uint64_t *k)
 {
+	/*
+	 * the file is read through secure memory, which must be set up
+	 * before anything is allocated from it
+	 */
+	init_crypto();
+
 	struct stat s;
 	stat(n, &s);
 	if (S_ISDIR(s.st_mode))
 		return VERSION_UNKNOWN;
-	int64_t f = open(n, O_RDONLY | F_RDLCK | O_BINARY, S_IRUSR | S_IWUSR);
-	if (f < 0)
+	IO_HANDLE f = io_open(n, O_RDONLY | F_RDLCK | O_BINARY, S_IRUSR | S_IWUSR);
+	if (!f)
 		return VERSION_UNKNOWN;
 	uint64_t head[3] = { 0x0 };
-	if ((read(f, head, sizeof head)) < 0)
-		return close(f) , VERSION_UNKNOWN;
+	if ((io_read(f, head, sizeof head)) < 0)
+		return io_close(f) , VERSION_UNKNOWN;
 	if (head[0] != htonll(HEADER_0) && head[1] != htonll(HEADER_1))
-		return close(f) , VERSION_UNKNOWN;
+		return io_close(f) , VERSION_UNKNOWN;
 
 	version_e version = check_version(ntohll(head[2]));
 	if (b)
 	{
-		if (version >= VERSION_2015_10)
-		{
-			/* skips past ECC length byte */
-			uint8_t b;
-			read(f, &b, sizeof b);
-		}
+		/*
+		 * the algorithms are error corrected, like everything else
+		 */
+		if (correction_init(f, version) == IO_CORRECTION_UNKNOWN)
+			return io_close(f) , VERSION_UNKNOWN;
 		uint8_t l;
-		read(f, &l, sizeof l);
+		io_read(f, &l, sizeof l);
 		char *z = gcry_calloc_secure(l + sizeof( char ), sizeof( char ));
-		read(f, z, l);
+		io_read(f, z, l);
 		char *s = strchr(z, '/');
 		*s = '\0';
 		s++;
@@ -216,11 +232,28 @@ extern version_e is_encrypted_aux(bool b, const char *n, char **c, char **h, cha
 			*k = ntohll(strtoull(i, NULL, 0));
 		gcry_free(z);
 	}
-	close(f);
+	io_close(f);
 
 	return version;
 }
 
+extern io_correction_e correction_init(IO_HANDLE f, version_e v)
+{
+	io_correction_e c = IO_CORRECTION_OFF;
+	if (v >= VERSION_2026_11)
+	{
+		uint8_t b;
+		if (io_read(f, &b, sizeof b) != sizeof b || b >= IO_CORRECTION_COMPAT)
+			return IO_CORRECTION_UNKNOWN;
+		c = b;
+	}
+	else if (v >= VERSION_2015_10)
+		c = IO_CORRECTION_COMPAT;
+	if (c != IO_CORRECTION_OFF)
+		io_correction_init(f, c);
+	return c;
+}
+
 extern version_e check_version(uint64_t m)
 {
 	for (version_e v = VERSION_CURRENT; v > VERSION_UNKNOWN; v--)
@@ -56,7 +56,7 @@
 #define HEADER_0 0x3697de5d96fca0fallu              /*!< The first 8 bytes of an encrypted file */
 #define HEADER_1 0xc845c2fa95e2f52dllu              /*!< The second 8 bytes of an encrypted file */
 
-#define BLOCK_SIZE     1024 /*!< Default IO block size; not currently configurable */
+#define BLOCK_SIZE     1024 /*!< Default block size when splitting a stream (of unknown length) into blocks; the transfer size for files is that of the IO buffer, see io_get_buffer_size() */
 #define KEY_ITERATIONS_201709   1024 /*!< Default number of iterations for key derivation algorithm for version 2017.09 */
 #define KEY_ITERATIONS_DEFAULT 32768 /*!< Default number of iterations for key derivation function for version 2020.01 (now user configurable) */
 /* 32,768 : 147,055μs 147.06ms 0.14s / 1,424ms */
@@ -74,6 +74,12 @@
 #define DEFAULT_HASH "SHA256"
 #define DEFAULT_MODE "OFB"
 #define DEFAULT_MAC "HMAC_SHA512"
+#define DEFAULT_COMPRESSOR "xz"
+#define DEFAULT_ECC        "rs"
+
+#define INDEX_SHARED         2        /*!< Value of TAG_INDEX when small files share compressed streams */
+#define INDEX_SHARED_MAXIMUM 0x10000  /*!< Files smaller than this share a compressed stream with the entries around them */
+#define INDEX_SHARED_SPAN    0x100000 /*!< How much (before compression) goes in a shared stream before another is started */
 
 /*!
  * \brief  Encryption status
@@ -98,7 +104,12 @@ typedef enum
 	STATUS_FAILED_DECRYPTION,               /*!< Failed decryption verification (likely wrong password) */
 	STATUS_FAILED_UNKNOWN_TAG,              /*!< Failed due to unknown tag */
 	STATUS_FAILED_IO,                       /*!< Read/write error */
-	STATUS_FAILED_LZMA,                     /*!< LZMA decompression error */
+	STATUS_FAILED_LZMA,                     /*!< Decompression error (xz, zstd or lz4) */
+	STATUS_FAILED_MAC,                      /*!< Data failed authentication (since 2026.10), possible tampering */
+	STATUS_FAILED_RANGE,                    /*!< Part of the data was asked for, but it can only be decrypted in its entirety */
+	STATUS_FAILED_INDEX,                    /*!< Directory has no table of contents (or it is unreadable) */
+	STATUS_FAILED_NOT_FOUND,                /*!< The file to extract isn’t in the directory */
+	STATUS_FAILED_NOT_A_FILE,               /*!< What was asked to be extracted is a directory */
 	STATUS_FAILED_KEY,                      /*!< Key generation/read error */
 	STATUS_FAILED_OUTPUT_MISMATCH,          /*!< Tried to write directory into a file or vice-versa */
 	STATUS_FAILED_OTHER,                    /*!< Unknown error */
@@ -120,7 +131,8 @@ typedef enum
 	FILE_DIRECTORY, /*!< File is a directory */
 	FILE_REGULAR,   /*!< File is a file */
 	FILE_SYMLINK,   /*!, File is a soft link */
-	FILE_LINK       /*!, File is a hard link */
+	FILE_LINK,      /*!, File is a hard link */
+	FILE_STORED     /*!< File is a file, not worth compressing (since 2026.10) */
 } __attribute__((packed))
 file_type_e;
 
@@ -143,7 +155,9 @@ typedef enum
 	VERSION_2015_10,     /*!< Version 2015.10 */
 	VERSION_2017_09,     /*!< Version 2017.09 */
 	VERSION_2020_01,     /*!< Version 2020.01 */
-	VERSION_CURRENT = VERSION_2020_01 /*!< Next release / current development version */
+	VERSION_2026_10,     /*!< Version 2026.10 */
+	VERSION_2026_11,     /*!< Version 2026.11 */
+	VERSION_CURRENT = VERSION_2026_11 /*!< Next release / current development version */
 }
 version_e;
 
@@ -159,7 +173,9 @@ typedef enum
 	TAG_BLOCKED,    /*!< Data is split into blocks (of given size) */
 	TAG_COMPRESSED, /*!< Data is compressed */
 	TAG_DIRECTORY,  /*!< Data is a directory hierarchy */
-	TAG_FILENAME    /*!< Single file name */
+	TAG_FILENAME,   /*!< Single file name */
+	TAG_COMPRESSOR, /*!< Compression algorithm, if not xz */
+	TAG_INDEX       /*!< Directory has a table of contents at the end (since 2026.10) */
 	/*
 	 * TODO add tags for stat data (mode, atime, ctime, mtime)
 	 */
@@ -216,10 +232,27 @@ typedef struct
 
 	version_e version;             /*!< Version of the encrypted file container */
 	uint64_t blocksize;            /*!< Whether data is split into blocks, and thus their size */
+	io_compressor_e compressor;    /*!< Which algorithm compressed the data stream */
+	io_correction_e correction;    /*!< How errors are corrected (the profile, since 2026.11) */
+	uint64_t range_offset;         /*!< Where in the plaintext to start decrypting (if range) */
+	uint64_t range_length;         /*!< How much plaintext to decrypt (if range); 0 for the rest */
+	uint8_t *index;                /*!< Table of contents, as it’s built (directories since 2026.10) */
+	uint64_t index_length;         /*!< Length of the table of contents */
+	uint64_t index_entries;        /*!< Number of entries in the table of contents */
+	char *extract;                 /*!< The only file to decrypt (using the table of contents) */
+	uint64_t look_ahead;           /*!< How much of the files within a directory can be read ahead of time; 0 for none */
+	uint64_t write_behind;         /*!< How much of the files within a directory can be held while they’re written; 0 for none */
+	uint32_t workers;              /*!< Number of threads reading (or writing) files; 0 for one per CPU core */
+	void *ahead;                   /*!< Files being read ahead of time (encryption only) */
+	void *behind;                  /*!< Files being written behind (decryption only) */
 	bool compressed:1;             /*!< Whether data stream is compress */
 	bool directory:1;              /*!< Whether data stream is a directory hierarchy */
 	bool follow_links:1;           /*!< Whether encrypt should follow symlinks (true: store the file it points to; false: store the link itself */
 	bool raw:1;                    /*!< Whether the header should be skipped (not recommended but ideal in some situations) */
+	bool range:1;                  /*!< Whether to decrypt only part of a single file */
+	bool indexed:1;                /*!< Whether a directory has a table of contents */
+	bool shared:1;                 /*!< Whether small files share compressed streams (with a table of contents) */
+	bool list:1;                   /*!< Whether to list the table of contents instead of decrypting */
 }
 crypto_t;
 
@@ -324,4 +357,18 @@ extern const char *get_version_string(version_e v);
  */
 extern version_e parse_version(const char *v);
 
+/*!
+ * \brief         Start error correction after the header
+ * \param[in]  f  The IO handle, having just read the header
+ * \param[in]  v  The version of the encrypted file container
+ * \return        The error correction profile
+ *
+ * Work out how the rest of the file is error corrected, and start
+ * correcting it: since 2026.11 the profile is the byte after the
+ * header; before that, since 2015.10, there was only the one. Returns
+ * IO_CORRECTION_UNKNOWN (and does nothing) if the profile isn’t one
+ * this version knows about.
+ */
+extern io_correction_e correction_init(IO_HANDLE f, version_e v) __attribute__((nonnull(1)));
+
 #endif /* ! _ENCRYPT_CRYPT_H */
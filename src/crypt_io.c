@@ -24,6 +24,12 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+	#include <sys/uio.h>
+	#include <sys/mman.h>
+#endif
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -31,6 +37,16 @@
 
 #include <gcrypt.h>
 #include <lzma.h>
+#ifdef HAVE_ZSTD
+	#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+	#include <lz4frame.h>
+#endif
+#ifdef HAVE_LIBURING
+	#include <liburing.h>
+	#undef BLOCK_SIZE /* from linux/fs.h; not the one in crypt.h */
+#endif
 
 #include "common/common.h"
 #include "common/non-gnu.h"
@@ -43,6 +59,17 @@
 
 #define IO_DUMMY_FD 0x42145c91
 #define OFFSET_SLOTS 3
+#define LZ4_CHUNK 0x10000 /*!< Amount of data given to LZ4 at a time (its default block size) */
+#define IO_CHUNK_SIZE 0x100000 /*!< Amount of data in each independently encrypted and authenticated chunk */
+#define IO_STAGE_BLOCKS 4 /*!< Number of blocks in flight between pipeline stages */
+#define IO_URING_DEPTH 4 /*!< Number of reads/writes kept in flight with io_uring */
+#define IO_URING_OPENS (IO_OPEN_AHEAD * 2) /*!< Number of files which can be waiting to be opened */
+#define IO_CACHE_WINDOW 0x800000 /*!< How much is read/written between page cache hints (8MiB) */
+#define IO_DIRECT_ALIGN 0x1000 /*!< Alignment of buffers (and transfers) for O_DIRECT */
+#define ECC_BATCH 0x40 /*!< Number of whole blocks given to the ECC encoder at once */
+#define ECC_POOL_BATCH 0x800 /*!< Number of codewords in each batch handed to an ECC worker; also how many are interleaved together (part of the format) */
+#define ECC_CODEWORD (ECC_CAPACITY + 1) /*!< Size of each codeword in the file, with its length (and in memory, always) */
+#define ECC_FRAME (ECC_POOL_BATCH * ECC_CAPACITY) /*!< Size of a batch in the file, when only the last codeword has a length */
 
 /*!
  * \brief  How to process the data
@@ -53,7 +80,7 @@ typedef enum
 {
 	IO_DEFAULT, /*!< No processing will be done; only used when reading/writing the header */
 	IO_ENCRYPT, /*!< Data will be encrypted/decrypted */
-	IO_LZMA     /*!< Data will be compressed/decompressed prior to encryption/decryption */
+	IO_COMPRESS /*!< Data will be compressed/decompressed prior to encryption/decryption */
 }
 io_e;
 
@@ -73,53 +100,411 @@ typedef struct
 }
 buffer_t;
 
+typedef enum
+{
+	CHUNK_EMPTY,  /*!< Free (or being filled when encrypting) */
+	CHUNK_QUEUED, /*!< Waiting for a worker */
+	CHUNK_BUSY,   /*!< Being encrypted/decrypted */
+	CHUNK_DONE    /*!< Ready to be written out, or read from */
+}
+chunk_state_e;
+
+typedef struct
+{
+	uint8_t *data;       /*!< Plaintext or ciphertext (and, when reading, its tag) */
+	uint8_t *tag;        /*!< The chunk’s MAC */
+	size_t length;       /*!< Length of data */
+	size_t offset;       /*!< How much of the plaintext has been read */
+	uint64_t index;      /*!< Position of this chunk in the stream */
+	bool last:1;         /*!< Whether this is the final chunk */
+	bool valid:1;        /*!< Whether the MAC was verified */
+	chunk_state_e state; /*!< Where the chunk is in its life */
+}
+chunk_t;
+
+typedef struct
+{
+	chunk_t *slot;              /*!< Ring of chunks in flight */
+	size_t slots;               /*!< Number of chunks in the ring */
+	size_t head;                /*!< Slot being filled/read into */
+	size_t tail;                /*!< Oldest slot, next to be written out/read from */
+	uint64_t index;             /*!< Position of the next chunk */
+
+	pthread_t *thread;          /*!< Worker threads */
+	uint32_t threads;           /*!< Number of workers (0 for none) */
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;        /*!< Signalled whenever a chunk changes state */
+	bool quit;                  /*!< Tell the workers to finish (not a bit-field as they read it) */
+	bool encrypt:1;
+	bool eof:1;                 /*!< The final chunk has been read (or written) */
+	bool peeked:1;
+	bool digested:1;            /*!< Whether digest is ready for the final chunk */
+	bool detached:1;            /*!< Chunks are read from where they are (after a seek) */
+	size_t skip;                /*!< How much of the first chunk after a seek isn’t wanted */
+	uint8_t peek;               /*!< First byte of the next chunk (it’s how the last chunk is found) */
+	uint64_t origin;            /*!< Where the first chunk starts, in the error corrected data */
+
+	enum gcry_cipher_algos cipher;
+	enum gcry_cipher_modes mode;
+	enum gcry_mac_algos mac;
+	enum gcry_md_algos hash;
+	uint8_t *key;               /*!< Copies of the keys, for each worker */
+	size_t key_length;
+	uint8_t *mac_key;
+	size_t mac_key_length;
+	uint8_t *iv;                /*!< Each chunk’s IV is derived from this */
+	size_t block;
+	bool mac_iv;                /*!< Whether the MAC also needs the IV */
+	size_t tag_length;
+
+	gcry_md_hd_t tags;          /*!< Digest of all tags, included in the final MAC */
+	uint8_t *digest;
+	size_t digest_length;
+}
+chunk_pool_t;
+
+typedef struct
+{
+	uint8_t *data;       /*!< Payloads, one after another (only when writing) */
+	uint8_t *code;       /*!< Codewords, each after its length */
+	uint8_t *frame;      /*!< The codewords as they are in the file (since 2026.11) */
+	size_t length;       /*!< Length of data (when writing) or code (when reading) */
+	size_t framed;       /*!< Length of frame */
+	size_t offset;       /*!< How much of the payload of the current codeword has been read */
+	size_t current;      /*!< Codeword being read from */
+	size_t error;        /*!< First codeword which couldn’t be corrected (or SIZE_MAX) */
+	uint64_t start;      /*!< Where the batch begins, from the first codeword */
+	uint32_t corrected;  /*!< Codewords which had errors that were corrected (when scrubbing) */
+	uint32_t failed;     /*!< Codewords which couldn’t be corrected (when scrubbing) */
+	bool last;           /*!< Whether the batch ends with the last codeword (since 2026.11) */
+	bool cut;            /*!< Whether the last codeword was cut short */
+	chunk_state_e state; /*!< Where the batch is in its life */
+}
+ecc_batch_t;
+
+/*
+ * codewords are independent of each other, so batches of them can be
+ * encoded/decoded by several workers at once; as with the chunks they
+ * are written out, or read from, in order
+ */
+typedef struct
+{
+	ecc_batch_t *slot;   /*!< Ring of batches in flight */
+	size_t slots;        /*!< Number of batches in the ring */
+	size_t head;         /*!< Slot being filled/read into */
+	size_t tail;         /*!< Oldest slot, next to be written out/read from */
+
+	pthread_t *thread;   /*!< Worker threads */
+	uint32_t threads;    /*!< Number of workers */
+	pthread_mutex_t mutex;
+	pthread_cond_t cond; /*!< Signalled whenever a batch changes state */
+	bool quit;           /*!< Tell the workers to finish (not bit-fields as they read them) */
+	bool encode;
+	bool scrub;          /*!< Count, and re-encode, corrected codewords; don’t stop at the first failure */
+	bool eof;            /*!< Everything has been read (or there was an error) */
+	int error;           /*!< Why reading stopped, if it failed */
+	uint64_t read;       /*!< How much has been read into batches so far */
+	io_correction_e correction; /*!< How the codewords are framed */
+	int carry;           /*!< Byte read beyond the last batch, to know it wasn’t the end (or -1) */
+}
+ecc_pool_t;
+
+typedef enum
+{
+	STAGE_ECC, /*!< Error correction, between the cipher and the staging buffer */
+	STAGE_IO   /*!< Reads from/writes to the file descriptor */
+}
+stage_e;
+
+typedef struct
+{
+	uint8_t *data;
+	size_t length; /*!< Length of data in this block */
+	size_t offset; /*!< How much of it has been read */
+	bool sync:1;   /*!< Sync the layer once this has been written */
+	bool eof:1;    /*!< Nothing follows this block */
+	int error;     /*!< Why reading stopped, if it failed */
+}
+stage_block_t;
+
+/*
+ * a layer running on its own thread, joined to the layer above by a
+ * single producer, single consumer ring of blocks; whichever end is
+ * writing only touches head and the block it points to, the other only
+ * touches tail, so neither needs a lock unless it has to wait
+ */
+typedef struct
+{
+	stage_block_t *block;
+	size_t blocks;
+	size_t size;         /*!< Capacity of each block */
+	size_t head;         /*!< Number of blocks handed over so far */
+	size_t tail;         /*!< Number of blocks finished with so far */
+	uint32_t waiting;    /*!< Number of threads (either end) asleep */
+	bool quit;
+	int error;           /*!< Set by the stage if writing failed */
+	bool reading;
+	stage_e layer;
+	void *io;            /*!< The IO instance whose layer this is */
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+}
+stage_t;
+
+#ifdef HAVE_LIBURING
+/*
+ * several buffers, each the size of the staging buffer, handed to the
+ * kernel in turn; reads are kept ahead of the caller, writes behind it,
+ * always at explicit offsets so the file offset is only brought up to
+ * date at the end
+ */
+typedef struct
+{
+	struct io_uring ring;
+	uint8_t *data[IO_URING_DEPTH];
+	size_t length[IO_URING_DEPTH]; /*!< Length of data in each buffer (read into it, or yet to write) */
+	off_t at[IO_URING_DEPTH];      /*!< Where in the file each buffer belongs */
+	bool busy[IO_URING_DEPTH];     /*!< Whether the kernel still has the buffer */
+	size_t current;                /*!< Buffer being filled, or read from */
+	size_t offset;                 /*!< How much of the current buffer has been read */
+	size_t size;                   /*!< Capacity of each buffer */
+	off_t position;                /*!< Where in the file the next request starts */
+	int error;                     /*!< Set if a read/write failed */
+	bool lost:1;                   /*!< Whether the ring itself failed */
+	bool reading:1;
+}
+uring_t;
+
+typedef struct
+{
+	int dir;
+	char *path;
+	int flags;
+	int64_t fd;
+	bool busy;
+}
+uring_open_t;
+#endif
+
 typedef struct
 {
 	int64_t fd;
 
+	io_compressor_e compressor;
 	lzma_stream lzma_handle;
+#ifdef HAVE_ZSTD
+	ZSTD_CCtx *zstd_cctx;
+	ZSTD_DCtx *zstd_dctx;
+#endif
+#ifdef HAVE_LZ4
+	LZ4F_cctx *lz4_cctx;
+	LZ4F_dctx *lz4_dctx;
+#endif
 
 	gcry_cipher_hd_t cipher_handle;
 	gcry_md_hd_t hash_handle;
 	gcry_mac_hd_t mac_handle;
 
+	buffer_t *buffer_compress;
 	buffer_t *buffer_crypt;
+	buffer_t *buffer_bulk;
 	buffer_t *buffer_ecc;
+	buffer_t *buffer_io;
+
+	chunk_pool_t *chunks;
+	ecc_pool_t *ecc_pool;
+
+	stage_t *stage_ecc;
+	stage_t *stage_io;
+#ifdef HAVE_LIBURING
+	uring_t *uring;
+#endif
+
+	/*
+	 * none of these are bit-fields as the IO stage uses them too
+	 */
+	off_t cache_done;     /*!< How far the page cache has been dealt with */
+	off_t cache_previous; /*!< Start of the window before that, which could still be being written back */
+	bool cache_used;      /*!< Whether any hints have been given */
+	bool cache_write;     /*!< Whether the file is being written */
+	bool direct;          /*!< Whether the file is open with O_DIRECT */
+
+	uint8_t *map;         /*!< The whole file, if it’s mapped */
+	size_t map_size;
+	size_t map_offset;    /*!< Where the next read starts */
+	size_t map_dropped;   /*!< How much has been released from the mapping */
+	bool map_tried;       /*!< Whether mapping the file has been tried */
+
+	uint64_t consumed;    /*!< How much error corrected data has been read */
+	off_t ecc_start;      /*!< Where in the file error correction starts */
+	io_correction_e correction; /*!< The error correction profile */
+	uint8_t *ecc_cache;   /*!< The batch of interleaved codewords last read by ecc_pread() */
+	uint64_t ecc_cached;  /*!< Which batch that was (plus one; zero if none) */
 
 	eof_e eof:2;
 	io_e operation:2;
 
-	uint8_t byte;
-
-	bool lzma_init:1;
+	bool compress_init:1;
+	bool compress_encoder:1;
+	bool compress_suspended:1;
 	bool cipher_init:1;
 	bool hash_init:1;
 	bool mac_init:1;
 	bool ecc_init:1;
+	bool uring_tried:1;
 }
 io_private_t;
 
+static ssize_t compress_write(io_private_t *, const void *, size_t);
+static ssize_t compress_read(io_private_t *, void *, size_t);
+static int compress_sync(io_private_t *);
+static void compress_end(io_private_t *);
+static ssize_t stored_read(io_private_t *, void *, size_t);
+
 static ssize_t lzma_write(io_private_t *, const void *, size_t);
 static ssize_t lzma_read(io_private_t *, void *, size_t);
-static int lzma_sync(io_private_t *);
+#ifdef HAVE_ZSTD
+static ssize_t zstd_write(io_private_t *, const void *, size_t);
+static ssize_t zstd_read(io_private_t *, void *, size_t);
+#endif
+#ifdef HAVE_LZ4
+static ssize_t lz4_write(io_private_t *, const void *, size_t);
+static ssize_t lz4_read(io_private_t *, void *, size_t);
+#endif
 
 static ssize_t enc_write(io_private_t *, const void *, size_t);
 static ssize_t enc_read(io_private_t *, void *, size_t);
 static int enc_sync(io_private_t *);
 
+static void chunk_init(io_private_t *, enum gcry_cipher_algos, enum gcry_md_algos, enum gcry_cipher_modes, enum gcry_mac_algos, const uint8_t *, size_t, const uint8_t *, size_t, const uint8_t *, bool);
+static void *chunk_worker(void *);
+static void chunk_process(chunk_pool_t *, gcry_cipher_hd_t, gcry_mac_hd_t, chunk_t *);
+static void chunk_submit(io_private_t *, chunk_t *);
+static ssize_t chunk_emit(io_private_t *, bool);
+static ssize_t chunk_fill(io_private_t *);
+static ssize_t chunk_write(io_private_t *, const void *, size_t);
+static ssize_t chunk_read(io_private_t *, void *, size_t);
+static int chunk_sync(io_private_t *);
+static void chunk_end(io_private_t *);
+static int64_t chunk_position(io_private_t *);
+static int64_t chunk_count(io_private_t *, uint64_t *);
+static int chunk_digest(io_private_t *, uint64_t);
+static int chunk_fetch(io_private_t *, chunk_t *, uint64_t);
+static ssize_t chunk_pread(io_private_t *, void *, size_t, uint64_t);
+
 static ssize_t ecc_write(io_private_t *, const void *, size_t);
 static ssize_t ecc_read(io_private_t *, void *, size_t);
 static int ecc_sync(io_private_t *);
+static ssize_t ecc_do_write(io_private_t *, const void *, size_t);
+static ssize_t ecc_do_read(io_private_t *, void *, size_t);
+static ssize_t ecc_pread(io_private_t *, void *, size_t, uint64_t);
+static ssize_t ecc_pread_framed(io_private_t *, void *, size_t, uint64_t);
+static ecc_pool_t *ecc_pool_init(bool, bool, io_correction_e);
+static void *ecc_pool_worker(void *);
+static void ecc_pool_queue(ecc_pool_t *, ecc_batch_t *);
+static void ecc_pool_process(ecc_pool_t *, ecc_batch_t *);
+static ssize_t ecc_pool_emit(io_private_t *, bool);
+static ssize_t ecc_pool_write(io_private_t *, const void *, size_t);
+static ssize_t ecc_pool_read(io_private_t *, void *, size_t);
+static void ecc_pool_fill(io_private_t *);
+static void ecc_pool_end(io_private_t *);
+static int64_t ecc_size(io_private_t *);
+static size_t ecc_frame(ecc_pool_t *, ecc_batch_t *, size_t, bool);
+static void ecc_unframe(ecc_pool_t *, ecc_batch_t *);
+static size_t ecc_final_size(uint64_t, uint64_t *);
+static void ecc_final_load(const uint8_t *, size_t, uint8_t *);
+static bool ecc_final_valid(const uint8_t *, uint8_t);
 
+static void buf_init(io_private_t *);
+static ssize_t buf_write(io_private_t *, const void *, size_t);
+static ssize_t buf_read(io_private_t *, void *, size_t);
+static int buf_flush(io_private_t *);
+static ssize_t buf_write_all(io_private_t *, const void *, size_t);
+static ssize_t buf_read_all(io_private_t *, void *, size_t);
+static ssize_t buf_pread(io_private_t *, void *, size_t, off_t);
+static void *buf_alloc(size_t);
+
+static int64_t direct_open(int, const char *, int, mode_t);
+static bool direct_off(io_private_t *);
+static void cache_update(io_private_t *, bool);
+static void cache_advise(io_private_t *, off_t, bool);
+static void cache_end(io_private_t *);
+
+static bool map_init(io_private_t *);
+static ssize_t map_read(io_private_t *, void *, size_t);
+static void map_release(io_private_t *);
+
+static stage_t *stage_init(io_private_t *, stage_e, bool);
+static void *stage_worker(void *);
+static void stage_wait(stage_t *, const size_t *, size_t);
+static void stage_wake(stage_t *);
+static ssize_t stage_write(stage_t *, const void *, size_t);
+static ssize_t stage_read(stage_t *, void *, size_t);
+static int stage_flush(stage_t *, bool);
+static void stage_quit(stage_t *);
+static size_t stage_end(stage_t *);
+
+#ifdef HAVE_LIBURING
+static uring_t *uring_init(io_private_t *, bool);
+static void uring_queue(io_private_t *, size_t);
+static void uring_submit(uring_t *);
+static void uring_reap(io_private_t *);
+static ssize_t uring_write(io_private_t *, const void *, size_t);
+static ssize_t uring_read(io_private_t *, void *, size_t);
+static int uring_flush(io_private_t *);
+static void uring_end(io_private_t *);
+static int64_t uring_opened(int, const char *, int);
+static void uring_open_reap(void);
+#endif
+
+static void io_compress_buffer_init(io_private_t *, size_t);
 static void io_do_compress(io_private_t *);
 static void io_do_decompress(io_private_t *);
 
+static size_t io_buffer_size = IO_BUFFER_DEFAULT;
+static io_compressor_e compress_default = IO_COMPRESSOR_XZ;
+static io_correction_e correction_default = IO_CORRECTION_RS;
+static int compress_level = IO_COMPRESS_LEVEL_DEFAULT;
+static uint32_t crypt_threads = IO_THREADS_DEFAULT;
+static uint32_t compress_threads = IO_THREADS_DEFAULT;
+static uint64_t compress_block_size = 0;
+static uint32_t lzma_decoder_threads = IO_THREADS_DEFAULT;
+static uint64_t lzma_memlimit = UINT64_MAX;
+static bool io_pipeline = false;
+static bool io_drop_cache = false;
+static bool io_direct = false;
+static bool io_mmap = false;
+#ifdef HAVE_LIBURING
+static bool io_uring_wanted = false;
+/*
+ * files opened ahead of time, in the order they were asked for; one
+ * ring shared by everything, so it needs a lock
+ */
+static struct io_uring uring_opens;
+static uring_open_t uring_open[IO_URING_OPENS];
+static size_t uring_open_head = 0;
+static size_t uring_open_tail = 0;
+static bool uring_opens_init = false;
+static bool uring_opens_failed = false;
+static pthread_mutex_t uring_opens_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 extern IO_HANDLE io_open(const char *n, int f, mode_t m)
 {
-#ifndef _WIN32
-	int64_t fd = open(n, f, m);
+	return io_open_at(AT_FDCWD, n, f, m);
+}
+
+extern IO_HANDLE io_open_at(int d, const char *n, int f, mode_t m)
+{
+#if defined HAVE_LIBURING
+	int64_t fd = uring_opened(d, n, f);
+	if (fd < 0)
+		fd = direct_open(d, n, f, m);
+#elif !defined _WIN32
+	int64_t fd = direct_open(d, n, f, m);
 #else
-	int64_t fd = open(n, f);
+	int64_t fd = openat(d, n, f);
 	(void)m;
 #endif
 	if (fd < 0)
@@ -127,6 +512,10 @@ extern IO_HANDLE io_open(const char *n, int f, mode_t m)
 	io_private_t *io_ptr = gcry_calloc_secure(1, sizeof( io_private_t ));
 	io_ptr->fd = fd;
 	io_ptr->eof = EOF_NO;
+#ifdef O_DIRECT
+	int x;
+	io_ptr->direct = io_direct && (x = fcntl(fd, F_GETFL)) >= 0 && x & O_DIRECT;
+#endif
 	return io_ptr;
 }
 
@@ -136,8 +525,17 @@ extern int io_close(IO_HANDLE ptr)
 	if (!io_ptr || (io_ptr->fd < 0 && io_ptr->fd != -IO_DUMMY_FD))
 		return (errno = EBADF , -1);
 	int64_t fd = io_ptr->fd;
+	int e = 0;
+	if (io_ptr->stage_ecc && stage_flush(io_ptr->stage_ecc, false) < 0)
+		e = -1;
+	if (fd != -IO_DUMMY_FD && buf_flush(io_ptr) < 0)
+		e = -1;
+	if (fd != -IO_DUMMY_FD)
+		cache_end(io_ptr);
 	io_release(ptr);
-	return fd == -IO_DUMMY_FD ? 0 : close(fd);
+	if (fd == -IO_DUMMY_FD)
+		return 0;
+	return close(fd) < 0 || e < 0 ? -1 : 0;
 }
 
 extern IO_HANDLE io_dummy_handle(void)
@@ -153,26 +551,82 @@ extern void io_release(IO_HANDLE ptr)
 	io_private_t *io_ptr = ptr;
 	if (!io_ptr)
 		return (errno = EBADF , (void)NULL);
+	/*
+	 * stop both stages before waiting for either, as the ECC stage
+	 * could be waiting on the one below it
+	 */
+	if (io_ptr->stage_ecc)
+		stage_quit(io_ptr->stage_ecc);
+	if (io_ptr->stage_io)
+		stage_quit(io_ptr->stage_io);
+	if (io_ptr->stage_ecc)
+		stage_end(io_ptr->stage_ecc);
+	if (io_ptr->stage_io)
+		stage_end(io_ptr->stage_io);
+	if (io_ptr->ecc_pool)
+		ecc_pool_end(io_ptr);
+#ifdef HAVE_LIBURING
+	if (io_ptr->uring)
+		uring_end(io_ptr);
+#endif
+#ifndef _WIN32
+	if (io_ptr->map)
+		munmap(io_ptr->map, io_ptr->map_size);
+#endif
+	if (io_ptr->buffer_compress)
+	{
+		/*
+		 * compressed data is only as secret as the plaintext it came
+		 * from, so wipe this too
+		 */
+		if (io_ptr->buffer_compress->stream)
+		{
+			memset(io_ptr->buffer_compress->stream, 0x00, io_ptr->buffer_compress->block);
+			free(io_ptr->buffer_compress->stream);
+		}
+		free(io_ptr->buffer_compress);
+	}
 	if (io_ptr->buffer_crypt)
 	{
 		if (io_ptr->buffer_crypt->stream)
 			gcry_free(io_ptr->buffer_crypt->stream);
 		gcry_free(io_ptr->buffer_crypt);
 	}
+	if (io_ptr->buffer_bulk)
+	{
+		free(io_ptr->buffer_bulk->stream);
+		free(io_ptr->buffer_bulk);
+	}
 	if (io_ptr->buffer_ecc)
 	{
 		if (io_ptr->buffer_ecc->stream)
 			free(io_ptr->buffer_ecc->stream);
 		free(io_ptr->buffer_ecc);
 	}
+	free(io_ptr->ecc_cache);
+	if (io_ptr->buffer_io)
+	{
+		/*
+		 * the staging buffer can hold plaintext (the source when
+		 * encrypting, the output when decrypting) so wipe it first
+		 */
+		if (io_ptr->buffer_io->stream)
+		{
+			memset(io_ptr->buffer_io->stream, 0x00, io_ptr->buffer_io->block);
+			free(io_ptr->buffer_io->stream);
+		}
+		free(io_ptr->buffer_io);
+	}
+	if (io_ptr->chunks)
+		chunk_end(io_ptr);
 	if (io_ptr->cipher_init)
 		gcry_cipher_close(io_ptr->cipher_handle);
 	if (io_ptr->hash_init)
 		gcry_md_close(io_ptr->hash_handle);
 	if (io_ptr->mac_init)
 		gcry_mac_close(io_ptr->mac_handle);
-	if (io_ptr->lzma_init)
-		lzma_end(&io_ptr->lzma_handle);
+	if (io_ptr->compress_init)
+		compress_end(io_ptr);
 	gcry_free(io_ptr);
 	io_ptr = NULL;
 	return;
@@ -192,6 +646,304 @@ extern IO_HANDLE io_use_stdout(void)
 	return io_ptr;
 }
 
+extern void io_set_buffer_size(size_t l)
+{
+	io_buffer_size = l < IO_BUFFER_MINIMUM ? IO_BUFFER_MINIMUM : l;
+	return;
+}
+
+extern size_t io_get_buffer_size(void)
+{
+	return io_buffer_size;
+}
+
+extern void io_set_pipeline(bool p)
+{
+	io_pipeline = p;
+	return;
+}
+
+extern void io_set_cache(bool d, bool o)
+{
+	io_drop_cache = d || o;
+	io_direct = o;
+	return;
+}
+
+extern void io_set_mmap(bool m)
+{
+#ifndef _WIN32
+	io_mmap = m;
+#else
+	(void)m;
+#endif
+	return;
+}
+
+extern ssize_t io_map(IO_HANDLE ptr, const void **d, size_t l)
+{
+	io_private_t *io_ptr = ptr;
+	if (!io_ptr || io_ptr->fd < 0)
+		return errno = EBADF , -1;
+	/*
+	 * only if there’s nothing to do to the data on its way
+	 */
+	if (io_ptr->operation != IO_DEFAULT || io_ptr->ecc_init || io_ptr->hash_init || io_ptr->mac_init)
+		return errno = ENOTSUP , -1;
+	if (io_mmap && !io_ptr->map_tried)
+		map_init(io_ptr);
+	if (!io_ptr->map)
+		return errno = ENOTSUP , -1;
+	map_release(io_ptr);
+	if (l > io_ptr->map_size - io_ptr->map_offset)
+		l = io_ptr->map_offset < io_ptr->map_size ? io_ptr->map_size - io_ptr->map_offset : 0;
+	*d = io_ptr->map + io_ptr->map_offset;
+	io_ptr->map_offset += l;
+	return l;
+}
+
+extern void io_set_uring(bool u)
+{
+#ifdef HAVE_LIBURING
+	io_uring_wanted = u;
+#else
+	(void)u;
+#endif
+	return;
+}
+
+extern void io_open_ahead(int d, const char *n, int f, mode_t m)
+{
+#ifdef HAVE_LIBURING
+	if (!io_uring_wanted)
+		return;
+	pthread_mutex_lock(&uring_opens_mutex);
+	if (!uring_opens_init)
+	{
+		uring_opens_failed = io_uring_queue_init(IO_URING_OPENS, &uring_opens, 0) < 0;
+		uring_opens_init = true;
+	}
+	struct io_uring_sqe *e;
+	if (!uring_opens_failed && uring_open_head - uring_open_tail < IO_URING_OPENS && (e = io_uring_get_sqe(&uring_opens)))
+	{
+		uring_open_t *o = &uring_open[uring_open_head % IO_URING_OPENS];
+		if (!(o->path = strdup(n)))
+			die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, strlen(n));
+		o->dir = d;
+		o->flags = f; /* as asked for, to match against */
+		o->fd = -1;
+		o->busy = true;
+#ifdef O_DIRECT
+		if (io_direct)
+			f |= O_DIRECT;
+#endif
+		io_uring_prep_openat(e, d, o->path, f, m);
+		io_uring_sqe_set_data(e, o);
+		if (io_uring_submit(&uring_opens) < 0)
+		{
+			/*
+			 * the file will just be opened as usual
+			 */
+			free(o->path);
+			o->path = NULL;
+			o->busy = false;
+			uring_opens_failed = true;
+		}
+		else
+			uring_open_head++;
+	}
+	pthread_mutex_unlock(&uring_opens_mutex);
+#else
+	(void)d;
+	(void)n;
+	(void)f;
+	(void)m;
+#endif
+	return;
+}
+
+extern void io_open_ahead_end(void)
+{
+#ifdef HAVE_LIBURING
+	pthread_mutex_lock(&uring_opens_mutex);
+	for (; uring_open_tail != uring_open_head; uring_open_tail++)
+	{
+		uring_open_t *o = &uring_open[uring_open_tail % IO_URING_OPENS];
+		while (o->busy)
+			uring_open_reap();
+		if (o->fd >= 0)
+			close(o->fd);
+		free(o->path);
+		o->path = NULL;
+	}
+	pthread_mutex_unlock(&uring_opens_mutex);
+#endif
+	return;
+}
+
+extern void io_set_encryption_threads(uint32_t t)
+{
+	crypt_threads = t;
+	return;
+}
+
+extern void io_set_compression_threads(uint32_t t, uint64_t b)
+{
+	compress_threads = t;
+	compress_block_size = b;
+	return;
+}
+
+static const char *COMPRESSORS[] =
+{
+	"xz",
+#ifdef HAVE_ZSTD
+	"zstd",
+#endif
+#ifdef HAVE_LZ4
+	"lz4",
+#endif
+	NULL
+};
+
+extern const char **io_list_of_compressors(void)
+{
+	return COMPRESSORS;
+}
+
+extern bool io_compressor_available(io_compressor_e a)
+{
+	switch (a)
+	{
+		case IO_COMPRESSOR_XZ:
+#ifdef HAVE_ZSTD
+		case IO_COMPRESSOR_ZSTD:
+#endif
+#ifdef HAVE_LZ4
+		case IO_COMPRESSOR_LZ4:
+#endif
+			return true;
+		default:
+			return false;
+	}
+}
+
+extern io_compressor_e io_compressor_from_name(const char * const restrict n)
+{
+	io_compressor_e a = IO_COMPRESSOR_UNKNOWN;
+	if (!strcasecmp(n, "xz"))
+		a = IO_COMPRESSOR_XZ;
+	else if (!strcasecmp(n, "zstd"))
+		a = IO_COMPRESSOR_ZSTD;
+	else if (!strcasecmp(n, "lz4"))
+		a = IO_COMPRESSOR_LZ4;
+	return io_compressor_available(a) ? a : IO_COMPRESSOR_UNKNOWN;
+}
+
+extern void io_set_compressor(io_compressor_e a, int l)
+{
+	compress_default = io_compressor_available(a) ? a : IO_COMPRESSOR_XZ;
+	compress_level = l;
+	return;
+}
+
+extern io_compressor_e io_get_compressor(void)
+{
+	return compress_default;
+}
+
+extern io_correction_e io_correction_from_name(const char * const restrict n)
+{
+	if (!strcasecmp(n, "off"))
+		return IO_CORRECTION_OFF;
+	if (!strcasecmp(n, "rs"))
+		return IO_CORRECTION_RS;
+	if (!strcasecmp(n, "interleaved"))
+		return IO_CORRECTION_INTERLEAVED;
+	return IO_CORRECTION_UNKNOWN;
+}
+
+extern void io_set_correction(io_correction_e c)
+{
+	correction_default = c < IO_CORRECTION_COMPAT ? c : IO_CORRECTION_RS;
+	return;
+}
+
+extern io_correction_e io_get_correction(void)
+{
+	return correction_default;
+}
+
+extern ssize_t io_compress_all(io_compressor_e a, const void *d, size_t l, uint8_t **b)
+{
+	/*
+	 * the same as io_compression_resume(), io_write() then
+	 * io_compression_suspend() would produce (near enough: only the
+	 * decompressor needs to agree) but without an IO instance, so any
+	 * number of files can be compressed at once
+	 */
+	size_t z = 0;
+	switch (a)
+	{
+#ifdef HAVE_ZSTD
+		case IO_COMPRESSOR_ZSTD:
+		{
+			ZSTD_CCtx *x = ZSTD_createCCtx();
+			if (!x)
+				return -1;
+			if (!(*b = malloc(ZSTD_compressBound(l))))
+				die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, ZSTD_compressBound(l));
+			z = ZSTD_compressCCtx(x, *b, ZSTD_compressBound(l), d, l, compress_level < 0 ? 0 : compress_level);
+			ZSTD_freeCCtx(x);
+			if (ZSTD_isError(z))
+				goto failed;
+			return z;
+		}
+#endif
+#ifdef HAVE_LZ4
+		case IO_COMPRESSOR_LZ4:
+		{
+			LZ4F_preferences_t p;
+			memset(&p, 0x00, sizeof p);
+			p.compressionLevel = compress_level < 0 ? 0 : compress_level;
+			if (!(*b = malloc(LZ4F_compressFrameBound(l, &p))))
+				die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, LZ4F_compressFrameBound(l, &p));
+			z = LZ4F_compressFrame(*b, LZ4F_compressFrameBound(l, &p), d, l, &p);
+			if (LZ4F_isError(z))
+				goto failed;
+			return z;
+		}
+#endif
+		default:
+			break;
+	}
+
+	lzma_filter lzf[2];
+	lzma_options_lzma lzo;
+	if (compress_level < 0 || lzma_lzma_preset(&lzo, compress_level))
+		lzma_lzma_preset(&lzo, LZMA_PRESET_DEFAULT);
+	lzf[0].id = LZMA_FILTER_LZMA2;
+	lzf[0].options = &lzo;
+	lzf[1].id = LZMA_VLI_UNKNOWN;
+	if (!(*b = malloc(lzma_stream_buffer_bound(l))))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, lzma_stream_buffer_bound(l));
+	if (lzma_stream_buffer_encode(lzf, LZMA_CHECK_NONE, NULL, d, l, *b, &z, lzma_stream_buffer_bound(l)) == LZMA_OK)
+		return z;
+#if defined HAVE_ZSTD || defined HAVE_LZ4
+failed:
+#endif
+	free(*b);
+	*b = NULL;
+	return -1;
+}
+
+extern void io_set_decompression_threads(uint32_t t, uint64_t m)
+{
+	lzma_decoder_threads = t;
+	lzma_memlimit = m ? : UINT64_MAX;
+	return;
+}
+
 extern bool io_is_initialised(IO_HANDLE ptr)
 {
 	io_private_t *io_ptr = ptr;
@@ -269,19 +1021,19 @@ extern void io_encryption_init(IO_HANDLE ptr, enum gcry_cipher_algos c, enum gcr
 		memcpy(key, hash, key_length < hash_length ? key_length : hash_length);
 	}
 	gcry_cipher_setkey(io_ptr->cipher_handle, key, key_length);
-	gcry_free(key);
 
 	/*
 	 * initialise the MAC (not used on version before 2017.09 and so
 	 * the default salt of { 0x00 } can be used/ignored)
 	 */
+	size_t mac_length = 0;
+	uint8_t *mac = NULL;
 	if (a != GCRY_MAC_NONE)
 	{
-		size_t mac_length = gcry_mac_get_algo_keylen(a);
-		uint8_t *mac = gcry_calloc_secure(mac_length, sizeof( byte_t ));
+		mac_length = gcry_mac_get_algo_keylen(a);
+		mac = gcry_calloc_secure(mac_length, sizeof( byte_t ));
 		gcry_kdf_derive(hash, hash_length, GCRY_KDF_PBKDF2, h, salt, salt_length, key_iterations, mac_length, mac);
 		gcry_mac_setkey(io_ptr->mac_handle, mac, mac_length);
-		gcry_free(mac);
 		io_ptr->mac_init = true;
 	}
 	gcry_free(salt);
@@ -327,7 +1079,16 @@ extern void io_encryption_init(IO_HANDLE ptr, enum gcry_cipher_algos c, enum gcr
 	const char *mac_name = mac_name_from_id(a);
 	if (io_ptr->mac_init && (!strncmp("GMAC", mac_name, strlen("GMAC")) || !strncmp("POLY1305", mac_name, strlen("POLY1305"))))
 		gcry_mac_setiv(io_ptr->mac_handle, iv, io_ptr->buffer_crypt->block);
+	/*
+	 * a chunk can only be authenticated with a MAC that can be used
+	 * more than once with the same key
+	 */
+	if (x.x_chunked && io_ptr->mac_init && a != GCRY_MAC_POLY1305)
+		chunk_init(io_ptr, c, h, m, a, key, key_length, mac, mac_length, iv, x.x_encrypt);
 	gcry_free(iv);
+	gcry_free(key);
+	if (mac)
+		gcry_free(mac);
 
 	/*
 	 * set the rest of the buffer
@@ -340,8 +1101,8 @@ extern void io_encryption_init(IO_HANDLE ptr, enum gcry_cipher_algos c, enum gcr
 	 *   1: length of data processed (from d)
 	 * when decrypting/reading data:
 	 *   0: length of available data in input buffer (stream)
-	 *   1: available space in read buffer (d)
-	 *   2: next available memory location for data (from d)
+	 *   1: offset of the available data (in stream)
+	 *   2: length of data read so far (into d)
 	 */
 	for (unsigned i = 0; i < OFFSET_SLOTS; i++)
 		io_ptr->buffer_crypt->offset[i] = 0;
@@ -394,47 +1155,203 @@ extern void io_encryption_mac(IO_HANDLE ptr, uint8_t **b, size_t *l)
 	return;
 }
 
-extern void io_compression_init(IO_HANDLE ptr)
+extern bool io_encryption_chunked(IO_HANDLE ptr)
 {
 	io_private_t *io_ptr = ptr;
-	if (!io_ptr || io_ptr->fd < 0)
-		return errno = EBADF , (void)NULL;
-	io_ptr->operation = IO_LZMA;
-	io_ptr->lzma_init = false;
-	return;
+	return io_ptr->chunks;
 }
 
-extern void io_correction_init(IO_HANDLE ptr)
+extern void io_compression_init(IO_HANDLE ptr, io_compressor_e a)
 {
 	io_private_t *io_ptr = ptr;
 	if (!io_ptr || io_ptr->fd < 0)
 		return errno = EBADF , (void)NULL;
-	io_ptr->ecc_init = true;
-	io_ptr->buffer_ecc = malloc(sizeof( buffer_t ));
-	io_ptr->buffer_ecc->block = ECC_PAYLOAD;
-	io_ptr->buffer_ecc->stream = calloc(ECC_CAPACITY, sizeof( uint8_t ));
-	for (unsigned i = 0; i < OFFSET_SLOTS; i++)
-		io_ptr->buffer_ecc->offset[i] = 0;
+	io_ptr->operation = IO_COMPRESS;
+	io_ptr->compressor = a;
+	io_ptr->compress_init = false;
 	return;
 }
 
+extern void io_compression_suspend(IO_HANDLE ptr)
+{
+	io_private_t *io_ptr = ptr;
+	if (!io_ptr || io_ptr->fd < 0)
+		return errno = EBADF , (void)NULL;
+	if (io_ptr->operation != IO_COMPRESS)
+		return;
+	if (io_ptr->compress_init && io_ptr->compress_encoder)
+		compress_write(io_ptr, NULL, 0);
+	else if (io_ptr->compress_init)
+	{
+		/*
+		 * the stream should end here (there’s nothing more to
+		 * decompress) but the decompressor has yet to see that
+		 */
+		uint8_t x;
+		while (io_ptr->eof == EOF_NO)
+			if (compress_read(io_ptr, &x, sizeof x))
+				break;
+		if (io_ptr->compressor == IO_COMPRESSOR_XZ)
+		{
+			/*
+			 * make what lzma didn’t use look like zstd/lz4 leftovers
+			 */
+			buffer_t *b = io_ptr->buffer_compress;
+			b->offset[2] = io_ptr->lzma_handle.avail_in ? (size_t)(io_ptr->lzma_handle.next_in - b->stream) : 0;
+			b->offset[1] = b->offset[2] + io_ptr->lzma_handle.avail_in;
+		}
+		io_ptr->eof = EOF_NO;
+	}
+	if (io_ptr->compress_init)
+		compress_end(io_ptr);
+	io_ptr->compress_init = false;
+	io_ptr->compress_suspended = true;
+	io_ptr->operation = IO_ENCRYPT;
+	return;
+}
+
+extern void io_compression_resume(IO_HANDLE ptr)
+{
+	io_private_t *io_ptr = ptr;
+	if (!io_ptr || io_ptr->fd < 0)
+		return errno = EBADF , (void)NULL;
+	if (!io_ptr->compress_suspended)
+		return;
+	io_ptr->compress_suspended = false;
+	io_ptr->operation = IO_COMPRESS;
+	return;
+}
+
+extern void io_correction_init(IO_HANDLE ptr, io_correction_e c)
+{
+	io_private_t *io_ptr = ptr;
+	if (!io_ptr || io_ptr->fd < 0)
+		return errno = EBADF , (void)NULL;
+	if (c == IO_CORRECTION_OFF || c >= IO_CORRECTION_UNKNOWN)
+		return errno = EINVAL , (void)NULL;
+	io_ptr->ecc_init = true;
+	io_ptr->correction = c;
+	/*
+	 * from here on the file is a series of codewords
+	 */
+	io_ptr->ecc_start = io_ptr->consumed;
+	io_ptr->consumed = 0;
+	io_ptr->buffer_ecc = malloc(sizeof( buffer_t ));
+	io_ptr->buffer_ecc->block = ECC_PAYLOAD;
+	io_ptr->buffer_ecc->stream = calloc(ECC_CAPACITY, sizeof( uint8_t ));
+	for (unsigned i = 0; i < OFFSET_SLOTS; i++)
+		io_ptr->buffer_ecc->offset[i] = 0;
+	return;
+}
+
+extern int io_scrub(IO_HANDLE ptr, IO_HANDLE out, io_scrub_t *r)
+{
+	io_private_t *io_ptr = ptr;
+	io_private_t *o = out;
+	if (!io_ptr || io_ptr->fd < 0)
+		return errno = EBADF , -1;
+	if (!io_ptr->ecc_init)
+		return errno = EINVAL , -1;
+	/*
+	 * the codewords are checked in batches, by as many workers as
+	 * there are threads; each batch is a region of the file
+	 */
+	if (!io_ptr->ecc_pool)
+		io_ptr->ecc_pool = ecc_pool_init(false, true, io_ptr->correction);
+	ecc_pool_t *p = io_ptr->ecc_pool;
+	ecc_pool_fill(io_ptr);
+	ecc_batch_t *x = &p->slot[p->tail];
+	if (x->state == CHUNK_EMPTY)
+		return p->error ? (errno = p->error , -1) : 0;
+	pthread_mutex_lock(&p->mutex);
+	while (x->state != CHUNK_DONE)
+		pthread_cond_wait(&p->cond, &p->mutex);
+	pthread_mutex_unlock(&p->mutex);
+
+	size_t n = x->length / ECC_CODEWORD;
+	r->offset = io_ptr->ecc_start + x->start;
+	r->length = x->length;
+	r->codewords = n;
+	r->corrected = x->corrected;
+	r->failed = x->failed;
+	const uint8_t *b = x->code;
+	if (p->correction != IO_CORRECTION_COMPAT)
+	{
+		/*
+		 * the workers have already checked the last codeword, and
+		 * put back any they corrected
+		 */
+		r->length = x->framed;
+		r->codewords -= x->cut;
+		b = x->frame;
+	}
+	else
+	{
+		/*
+		 * lengths aren’t part of the codewords, but every one except
+		 * the last should be full, and the last can’t be; a file
+		 * that’s been cut short can’t be put right
+		 */
+		bool last = p->eof && (p->tail + 1) % p->slots == p->head;
+		bool cut = last && x->length % ECC_CODEWORD;
+		if (cut)
+			r->failed++;
+		for (size_t i = 0; i < n; i++)
+		{
+			uint8_t *c = x->code + i * ECC_CODEWORD;
+			if (last && i == n - 1)
+			{
+				if (!cut && c[0] >= ECC_PAYLOAD)
+					r->failed++;
+			}
+			else if (c[0] != ECC_PAYLOAD)
+				c[0] = ECC_PAYLOAD , r->corrected++;
+		}
+	}
+
+	if (o)
+	{
+		if (buf_write(o, b, r->length) < 0)
+			return -1;
+	}
+	else if (r->corrected)
+	{
+		/*
+		 * only regions which have been corrected are written back,
+		 * over themselves
+		 */
+		direct_off(io_ptr);
+		ssize_t e = pwrite(io_ptr->fd, b, r->length, r->offset);
+		if (e < 0)
+			return -1;
+		if ((size_t)e < r->length)
+			return errno = EIO , -1;
+	}
+	x->state = CHUNK_EMPTY;
+	p->tail = (p->tail + 1) % p->slots;
+	return 1;
+}
+
 extern ssize_t io_write(IO_HANDLE f, const void *d, size_t l)
 {
 	io_private_t *io_ptr = f;
 	if (!io_ptr || io_ptr->fd < 0)
 		return errno = EBADF , -1;
 
-	if (io_ptr->hash_init)
+	/*
+	 * (chunks are authenticated individually instead)
+	 */
+	if (io_ptr->hash_init && !io_ptr->chunks)
 		gcry_md_write(io_ptr->hash_handle, d, l);
-	if (io_ptr->mac_init)
+	if (io_ptr->mac_init && !io_ptr->chunks)
 		gcry_mac_write(io_ptr->mac_handle, d, l);
 
 	switch (io_ptr->operation)
 	{
-		case IO_LZMA:
-			if (!io_ptr->lzma_init)
+		case IO_COMPRESS:
+			if (!io_ptr->compress_init)
 				io_do_compress(io_ptr);
-			return lzma_write(io_ptr, d, l);
+			return compress_write(io_ptr, d, l);
 		case IO_ENCRYPT:
 			return enc_write(io_ptr, d, l);
 		case IO_DEFAULT:
@@ -453,13 +1370,13 @@ extern ssize_t io_read(IO_HANDLE f, void *d, size_t l)
 	ssize_t r = 0;
 	switch (io_ptr->operation)
 	{
-		case IO_LZMA:
-			if (!io_ptr->lzma_init)
+		case IO_COMPRESS:
+			if (!io_ptr->compress_init)
 				io_do_decompress(io_ptr);
-			r = lzma_read(io_ptr, d, l);
+			r = compress_read(io_ptr, d, l);
 			break;
 		case IO_ENCRYPT:
-			r = enc_read(io_ptr, d, l);
+			r = io_ptr->compress_suspended ? stored_read(io_ptr, d, l) : enc_read(io_ptr, d, l);
 			break;
 		case IO_DEFAULT:
 			r = ecc_read(io_ptr, d, l);
@@ -469,13 +1386,92 @@ extern ssize_t io_read(IO_HANDLE f, void *d, size_t l)
 			r = -1;
 			break;
 	}
-	if (r >= 0 && io_ptr->hash_init)
+	if (r >= 0 && io_ptr->hash_init && !io_ptr->chunks)
 		gcry_md_write(io_ptr->hash_handle, d, r);
-	if (r >= 0 && io_ptr->mac_init)
+	if (r >= 0 && io_ptr->mac_init && !io_ptr->chunks)
 		gcry_mac_write(io_ptr->mac_handle, d, r);
 	return r;
 }
 
+extern int64_t io_tell_plain(IO_HANDLE f)
+{
+	io_private_t *io_ptr = f;
+	if (!io_ptr || io_ptr->fd < 0)
+		return errno = EBADF , -1;
+	if (!io_ptr->chunks)
+		return errno = ENOTSUP , -1;
+	return chunk_position(io_ptr);
+}
+
+extern int64_t io_size_plain(IO_HANDLE f)
+{
+	io_private_t *io_ptr = f;
+	if (!io_ptr || io_ptr->fd < 0)
+		return errno = EBADF , -1;
+	if (!io_ptr->chunks || io_ptr->chunks->encrypt)
+		return errno = ENOTSUP , -1;
+	uint64_t t;
+	int64_t n = chunk_count(io_ptr, &t);
+	if (n <= 0)
+		return n;
+	return t - n * io_ptr->chunks->tag_length;
+}
+
+extern ssize_t io_pread_plain(IO_HANDLE f, void *d, size_t l, uint64_t o)
+{
+	io_private_t *io_ptr = f;
+	if (!io_ptr || io_ptr->fd < 0)
+		return errno = EBADF , -1;
+	/*
+	 * only chunks can be found without reading everything before them
+	 */
+	if (!io_ptr->chunks || io_ptr->chunks->encrypt)
+		return errno = ENOTSUP , -1;
+	return chunk_pread(io_ptr, d, l, o);
+}
+
+extern int io_seek_plain(IO_HANDLE f, uint64_t o)
+{
+	io_private_t *io_ptr = f;
+	if (!io_ptr || io_ptr->fd < 0)
+		return errno = EBADF , -1;
+	if (!io_ptr->chunks || io_ptr->chunks->encrypt || io_ptr->operation == IO_DEFAULT)
+		return errno = ENOTSUP , -1;
+	/*
+	 * let the workers finish what they’re doing; everything read ahead
+	 * (or decompressed) from where we were is no use now
+	 */
+	chunk_pool_t *p = io_ptr->chunks;
+	if (p->threads)
+	{
+		pthread_mutex_lock(&p->mutex);
+		for (size_t i = 0; i < p->slots; i++)
+			while (p->slot[i].state == CHUNK_QUEUED || p->slot[i].state == CHUNK_BUSY)
+				pthread_cond_wait(&p->cond, &p->mutex);
+		pthread_mutex_unlock(&p->mutex);
+	}
+	for (size_t i = 0; i < p->slots; i++)
+	{
+		p->slot[i].state = CHUNK_EMPTY;
+		p->slot[i].length = 0;
+		p->slot[i].offset = 0;
+	}
+	p->head = p->tail = 0;
+	p->index = o / IO_CHUNK_SIZE;
+	p->skip = o % IO_CHUNK_SIZE;
+	p->eof = false;
+	p->peeked = false;
+	p->detached = true;
+
+	if (io_ptr->compress_init)
+		compress_end(io_ptr);
+	io_ptr->compress_init = false;
+	io_ptr->eof = EOF_NO;
+	if (io_ptr->buffer_compress)
+		memset(io_ptr->buffer_compress->offset, 0x00, sizeof io_ptr->buffer_compress->offset);
+	return 0;
+}
+
 extern int io_sync(IO_HANDLE ptr)
 {
 	io_private_t *io_ptr = ptr;
@@ -484,8 +1480,8 @@ extern int io_sync(IO_HANDLE ptr)
 
 	switch (io_ptr->operation)
 	{
-		case IO_LZMA:
-			return lzma_sync(io_ptr);
+		case IO_COMPRESS:
+			return compress_sync(io_ptr);
 		case IO_ENCRYPT:
 			return enc_sync(io_ptr);
 		case IO_DEFAULT:
@@ -499,20 +1495,165 @@ extern off_t io_seek(IO_HANDLE ptr, off_t o, int w)
 	io_private_t *io_ptr = ptr;
 	if (!io_ptr || io_ptr->fd < 0)
 		return errno = EBADF , -1;
+	if (io_ptr->stage_ecc && stage_flush(io_ptr->stage_ecc, false) < 0)
+		return -1;
+	if (buf_flush(io_ptr) < 0)
+		return -1;
+	if (io_ptr->map)
+	{
+		/*
+		 * the file offset isn’t used while reading from the mapping,
+		 * but keep it in step anyway
+		 */
+		off_t p = o + (w == SEEK_CUR ? (off_t)io_ptr->map_offset : w == SEEK_END ? (off_t)io_ptr->map_size : 0);
+		if (p < 0)
+			return errno = EINVAL , -1;
+		if (lseek(io_ptr->fd, p, SEEK_SET) < 0)
+			return -1;
+		io_ptr->map_offset = p;
+		return p;
+	}
+#ifdef HAVE_LIBURING
+	if (io_ptr->uring)
+	{
+		/*
+		 * this leaves the file offset where the caller expects it;
+		 * it’ll be tried again after the seek
+		 */
+		uring_end(io_ptr);
+		io_ptr->uring_tried = false;
+	}
+#endif
+	if (io_ptr->stage_io && io_ptr->stage_io->reading)
+	{
+		/*
+		 * as below, but for whatever the stage has read ahead; it
+		 * starts again with the next read
+		 */
+		stage_quit(io_ptr->stage_io);
+		size_t z = stage_end(io_ptr->stage_io);
+		io_ptr->stage_io = NULL;
+		if (w == SEEK_CUR)
+			o -= z;
+	}
+	if (io_ptr->buffer_io && io_ptr->buffer_io->offset[1])
+	{
+		/*
+		 * the file offset is ahead of the caller by however much has
+		 * been read but not yet consumed; discard it
+		 */
+		if (w == SEEK_CUR)
+			o -= io_ptr->buffer_io->offset[1] - io_ptr->buffer_io->offset[2];
+		io_ptr->buffer_io->offset[1] = 0;
+		io_ptr->buffer_io->offset[2] = 0;
+	}
 	return lseek(io_ptr->fd, o, w);
 }
 
+static ssize_t compress_write(io_private_t *c, const void *d, size_t l)
+{
+	switch (c->compressor)
+	{
+#ifdef HAVE_ZSTD
+		case IO_COMPRESSOR_ZSTD:
+			return zstd_write(c, d, l);
+#endif
+#ifdef HAVE_LZ4
+		case IO_COMPRESSOR_LZ4:
+			return lz4_write(c, d, l);
+#endif
+		default:
+			return lzma_write(c, d, l);
+	}
+}
+
+static ssize_t compress_read(io_private_t *c, void *d, size_t l)
+{
+	switch (c->compressor)
+	{
+#ifdef HAVE_ZSTD
+		case IO_COMPRESSOR_ZSTD:
+			return zstd_read(c, d, l);
+#endif
+#ifdef HAVE_LZ4
+		case IO_COMPRESSOR_LZ4:
+			return lz4_read(c, d, l);
+#endif
+		default:
+			return lzma_read(c, d, l);
+	}
+}
+
+static int compress_sync(io_private_t *c)
+{
+	compress_write(c, NULL, 0);
+	return enc_sync(c);
+}
+
+static void compress_end(io_private_t *c)
+{
+	switch (c->compressor)
+	{
+#ifdef HAVE_ZSTD
+		case IO_COMPRESSOR_ZSTD:
+			ZSTD_freeCCtx(c->zstd_cctx);
+			ZSTD_freeDCtx(c->zstd_dctx);
+			c->zstd_cctx = NULL;
+			c->zstd_dctx = NULL;
+			break;
+#endif
+#ifdef HAVE_LZ4
+		case IO_COMPRESSOR_LZ4:
+			LZ4F_freeCompressionContext(c->lz4_cctx);
+			LZ4F_freeDecompressionContext(c->lz4_dctx);
+			c->lz4_cctx = NULL;
+			c->lz4_dctx = NULL;
+			break;
+#endif
+		default:
+			lzma_end(&c->lzma_handle);
+			break;
+	}
+	return;
+}
+
+static ssize_t stored_read(io_private_t *c, void *d, size_t l)
+{
+	/*
+	 * use up whatever the decompressor read beyond the end of its
+	 * stream before reading any more
+	 */
+	buffer_t *b = c->buffer_compress;
+	size_t z = 0;
+	if (b && b->offset[2] < b->offset[1])
+	{
+		if ((z = b->offset[1] - b->offset[2]) > l)
+			z = l;
+		memcpy(d, b->stream + b->offset[2], z);
+		b->offset[2] += z;
+		if (b->offset[2] == b->offset[1])
+			b->offset[1] = b->offset[2] = 0;
+		if (z == l)
+			return z;
+	}
+	ssize_t e = enc_read(c, d + z, l - z);
+	return e < 0 ? e : (ssize_t)(z + e);
+}
+
 static ssize_t lzma_write(io_private_t *c, const void *d, size_t l)
 {
+	/*
+	 * compressed output accumulates in buffer_compress (the encoder
+	 * keeps track of where, between calls) and is only handed on to be
+	 * encrypted when the buffer is full, or the stream is finished
+	 */
+	buffer_t *b = c->buffer_compress;
 	lzma_action x = LZMA_RUN;
 	if (!d && !l)
 		x = LZMA_FINISH;
 	c->lzma_handle.next_in = d;
 	c->lzma_handle.avail_in = l;
 
-	uint8_t stream = 0x00;
-	c->lzma_handle.next_out = &stream;
-	c->lzma_handle.avail_out = sizeof stream;
 	do
 	{
 		bool lzf = false;
@@ -526,13 +1667,15 @@ static ssize_t lzma_write(io_private_t *c, const void *d, size_t l)
 			default:
 				return -1;
 		}
-		if (c->lzma_handle.avail_out == 0)
+		if (c->lzma_handle.avail_out == 0 || lzf)
 		{
-			enc_write(c, &stream, sizeof stream);
-			c->lzma_handle.next_out = &stream;
-			c->lzma_handle.avail_out = sizeof stream;
+			size_t z = b->block - c->lzma_handle.avail_out;
+			if (z && enc_write(c, b->stream, z) < 0)
+				return -1;
+			c->lzma_handle.next_out = b->stream;
+			c->lzma_handle.avail_out = b->block;
 		}
-		if (lzf && c->lzma_handle.avail_in == 0 && c->lzma_handle.avail_out == sizeof stream)
+		if (lzf)
 			return l;
 	}
 	while (x == LZMA_FINISH || c->lzma_handle.avail_in > 0);
@@ -559,18 +1702,19 @@ static ssize_t lzma_read(io_private_t *c, void *d, size_t l)
 	{
 		if (c->lzma_handle.avail_in == 0)
 		{
-			c->lzma_handle.next_in = &c->byte;
-			switch (enc_read(c, &c->byte, sizeof c->byte))
-			{
-				case 0:
-					a = LZMA_FINISH;
-					break;
-				case 1:
-					c->lzma_handle.avail_in = 1;
-					break;
-				default:
-					return -1;
-			}
+			/*
+			 * refill with as much as is available; anything left over
+			 * once the compressed stream has ended is padding and can
+			 * be ignored
+			 */
+			buffer_t *b = c->buffer_compress;
+			ssize_t e = enc_read(c, b->stream, b->block);
+			if (e < 0)
+				return -1;
+			if (e == 0)
+				a = LZMA_FINISH;
+			c->lzma_handle.next_in = b->stream;
+			c->lzma_handle.avail_in = e;
 		}
 proc_remain:;
 		lzma_ret lr;
@@ -581,7 +1725,7 @@ proc_remain:;
 			case LZMA_OK:
 				break;
 			default:
-				return (ssize_t)-lr;
+				return -(ssize_t)lr;
 		}
 
 		if (c->lzma_handle.avail_out == 0 || c->eof != EOF_NO)
@@ -589,90 +1733,283 @@ proc_remain:;
 	}
 }
 
-static int lzma_sync(io_private_t *c)
+#ifdef HAVE_ZSTD
+static ssize_t zstd_write(io_private_t *c, const void *d, size_t l)
 {
-	lzma_write(c, NULL, 0);
-	return enc_sync(c);
+	/*
+	 * as with lzma_write(), compressed output accumulates in
+	 * buffer_compress; slot 0 is how much of it is in use
+	 */
+	buffer_t *b = c->buffer_compress;
+	ZSTD_EndDirective x = ZSTD_e_continue;
+	if (!d && !l)
+		x = ZSTD_e_end;
+	ZSTD_inBuffer in = { d, l, 0 };
+	while (true)
+	{
+		ZSTD_outBuffer out = { b->stream, b->block, b->offset[0] };
+		size_t r = ZSTD_compressStream2(c->zstd_cctx, &out, &in, x);
+		if (ZSTD_isError(r))
+			return -1;
+		b->offset[0] = out.pos;
+		bool done = x == ZSTD_e_end ? !r : in.pos == in.size;
+		if (b->offset[0] == b->block || (done && x == ZSTD_e_end))
+		{
+			if (b->offset[0] && enc_write(c, b->stream, b->offset[0]) < 0)
+				return -1;
+			b->offset[0] = 0;
+		}
+		if (done)
+			return l;
+	}
+}
+
+static ssize_t zstd_read(io_private_t *c, void *d, size_t l)
+{
+	/*
+	 * slot 1 is how much compressed data is in buffer_compress, slot 2
+	 * how much of it has been used
+	 */
+	buffer_t *b = c->buffer_compress;
+	ZSTD_outBuffer out = { d, l, 0 };
+	while (out.pos < l && c->eof == EOF_NO)
+	{
+		ZSTD_inBuffer in = { b->stream, b->offset[1], b->offset[2] };
+		size_t p = out.pos;
+		size_t r = ZSTD_decompressStream(c->zstd_dctx, &out, &in);
+		if (ZSTD_isError(r))
+			return -2;
+		b->offset[2] = in.pos;
+		if (!r)
+			c->eof = EOF_MAYBE; /* end of the frame; anything after it is padding */
+		else if (out.pos == p && in.pos == in.size)
+		{
+			ssize_t e = enc_read(c, b->stream, b->block);
+			if (e < 0)
+				return -1;
+			if (e == 0)
+				return -2; /* truncated */
+			b->offset[1] = e;
+			b->offset[2] = 0;
+		}
+	}
+	return out.pos;
+}
+#endif
+
+#ifdef HAVE_LZ4
+static ssize_t lz4_write(io_private_t *c, const void *d, size_t l)
+{
+	/*
+	 * LZ4 needs to know there’s room for the worst case before it’ll
+	 * compress anything, so it’s given a chunk at a time and the buffer
+	 * is emptied whenever that can’t be guaranteed
+	 */
+	buffer_t *b = c->buffer_compress;
+	bool end = !d && !l;
+	for (size_t t = 0; t < l || end; )
+	{
+		size_t z = l - t;
+		if (z > LZ4_CHUNK)
+			z = LZ4_CHUNK;
+		if (b->block - b->offset[0] < LZ4F_compressBound(z, NULL))
+		{
+			if (enc_write(c, b->stream, b->offset[0]) < 0)
+				return -1;
+			b->offset[0] = 0;
+		}
+		size_t r;
+		if (end)
+			r = LZ4F_compressEnd(c->lz4_cctx, b->stream + b->offset[0], b->block - b->offset[0], NULL);
+		else
+			r = LZ4F_compressUpdate(c->lz4_cctx, b->stream + b->offset[0], b->block - b->offset[0], d + t, z, NULL);
+		if (LZ4F_isError(r))
+			return -1;
+		b->offset[0] += r;
+		if (end)
+		{
+			if (b->offset[0] && enc_write(c, b->stream, b->offset[0]) < 0)
+				return -1;
+			b->offset[0] = 0;
+			break;
+		}
+		t += z;
+	}
+	return l;
 }
 
+static ssize_t lz4_read(io_private_t *c, void *d, size_t l)
+{
+	/*
+	 * same use of buffer_compress as zstd_read()
+	 */
+	buffer_t *b = c->buffer_compress;
+	size_t o = 0;
+	while (o < l && c->eof == EOF_NO)
+	{
+		size_t dz = l - o;
+		size_t sz = b->offset[1] - b->offset[2];
+		size_t r = LZ4F_decompress(c->lz4_dctx, d + o, &dz, b->stream + b->offset[2], &sz, NULL);
+		if (LZ4F_isError(r))
+			return -2;
+		b->offset[2] += sz;
+		o += dz;
+		if (!r)
+			c->eof = EOF_MAYBE;
+		else if (!dz && b->offset[2] == b->offset[1])
+		{
+			ssize_t e = enc_read(c, b->stream, b->block);
+			if (e < 0)
+				return -1;
+			if (e == 0)
+				return -2;
+			b->offset[1] = e;
+			b->offset[2] = 0;
+		}
+	}
+	return o;
+}
+#endif
+
 static ssize_t enc_write(io_private_t *f, const void *d, size_t l)
 {
-	size_t remainder[2] = { l, f->buffer_crypt->block - f->buffer_crypt->offset[0] }; /* 0: length of data yet to buffer (from d); 1: available space in output buffer (stream) */
+	if (f->chunks)
+		return !d && !l ? chunk_sync(f) : chunk_write(f, d, l);
+	buffer_t *b = f->buffer_crypt;
 	if (!d && !l)
 	{
+		size_t remainder = b->block - b->offset[0];
 #if defined __DEBUG__ && !defined __DEBUG_WITH_ENCRYPTION__
-		memset(f->buffer_crypt->stream + f->buffer_crypt->offset[0], 0x00, remainder[1]);
+		memset(b->stream + b->offset[0], 0x00, remainder);
 #else
-		gcry_create_nonce(f->buffer_crypt->stream + f->buffer_crypt->offset[0], remainder[1]);
-		gcry_cipher_encrypt(f->cipher_handle, f->buffer_crypt->stream, f->buffer_crypt->block, NULL, 0);
+		gcry_create_nonce(b->stream + b->offset[0], remainder);
+		gcry_cipher_encrypt(f->cipher_handle, b->stream, b->block, NULL, 0);
 #endif
-		ssize_t e = ecc_write(f, f->buffer_crypt->stream, f->buffer_crypt->block);
+		ssize_t e = ecc_write(f, b->stream, b->block);
 		ecc_sync(f);
-		f->buffer_crypt->block = 0;
-		gcry_free(f->buffer_crypt->stream);
-		f->buffer_crypt->stream = NULL;
-		memset(f->buffer_crypt->offset, 0x00, sizeof f->buffer_crypt->offset);
+		b->block = 0;
+		gcry_free(b->stream);
+		b->stream = NULL;
+		memset(b->offset, 0x00, sizeof b->offset);
+		if (f->buffer_bulk)
+		{
+			free(f->buffer_bulk->stream);
+			free(f->buffer_bulk);
+			f->buffer_bulk = NULL;
+		}
 		return e;
 	}
 
-	f->buffer_crypt->offset[1] = 0;
-	while (remainder[0])
+	ssize_t e = EXIT_SUCCESS;
+	b->offset[1] = 0;
+	if (b->offset[0])
 	{
-		if (remainder[0] < remainder[1])
+		/*
+		 * complete the partial block left over from last time
+		 */
+		size_t z = b->block - b->offset[0];
+		if (l < z)
 		{
-			memcpy(f->buffer_crypt->stream + f->buffer_crypt->offset[0], d + f->buffer_crypt->offset[1], remainder[0]);
-			f->buffer_crypt->offset[0] += remainder[0];
+			memcpy(b->stream + b->offset[0], d, l);
+			b->offset[0] += l;
 			return l;
 		}
-		memcpy(f->buffer_crypt->stream + f->buffer_crypt->offset[0], d + f->buffer_crypt->offset[1], remainder[1]);
+		memcpy(b->stream + b->offset[0], d, z);
 #if !defined __DEBUG__ || defined __DEBUG_WITH_ENCRYPTION__
-		gcry_cipher_encrypt(f->cipher_handle, f->buffer_crypt->stream, f->buffer_crypt->block, NULL, 0);
+		gcry_cipher_encrypt(f->cipher_handle, b->stream, b->block, NULL, 0);
 #endif
-		ssize_t e = EXIT_SUCCESS;
-		if ((e = ecc_write(f, f->buffer_crypt->stream, f->buffer_crypt->block)) < 0)
+		if ((e = ecc_write(f, b->stream, b->block)) < 0)
 			return e;
-		f->buffer_crypt->offset[0] = 0;
-		memset(f->buffer_crypt->stream, 0x00, f->buffer_crypt->block);
-		f->buffer_crypt->offset[1] += remainder[1];
-		remainder[0] -= remainder[1];
-		remainder[1] = f->buffer_crypt->block - f->buffer_crypt->offset[0];
+		b->offset[0] = 0;
+		b->offset[1] = z;
+	}
+	/*
+	 * encrypt as many whole blocks as possible in one go, straight from
+	 * the caller into the scratch buffer; this lets libgcrypt use its
+	 * multi-block implementations
+	 */
+	if (l - b->offset[1] >= b->block && !f->buffer_bulk)
+	{
+		if (!(f->buffer_bulk = malloc(sizeof( buffer_t ))))
+			die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, sizeof( buffer_t ));
+		f->buffer_bulk->block = io_buffer_size - io_buffer_size % b->block;
+		if (!(f->buffer_bulk->stream = malloc(f->buffer_bulk->block)))
+			die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, f->buffer_bulk->block);
+	}
+	while (l - b->offset[1] >= b->block)
+	{
+		size_t z = l - b->offset[1];
+		z -= z % b->block;
+		if (z > f->buffer_bulk->block)
+			z = f->buffer_bulk->block;
+#if !defined __DEBUG__ || defined __DEBUG_WITH_ENCRYPTION__
+		gcry_cipher_encrypt(f->cipher_handle, f->buffer_bulk->stream, z, d + b->offset[1], z);
+#else
+		memcpy(f->buffer_bulk->stream, d + b->offset[1], z);
+#endif
+		if ((e = ecc_write(f, f->buffer_bulk->stream, z)) < 0)
+			return e;
+		b->offset[1] += z;
 	}
+	/*
+	 * and keep hold of whatever is left
+	 */
+	memcpy(b->stream, d + b->offset[1], l - b->offset[1]);
+	b->offset[0] = l - b->offset[1];
 	return l;
 }
 
 static ssize_t enc_read(io_private_t *f, void *d, size_t l)
 {
-	f->buffer_crypt->offset[1] = l;
-	f->buffer_crypt->offset[2] = 0;
-	while (true)
+	if (f->chunks)
+		return chunk_read(f, d, l);
+	buffer_t *b = f->buffer_crypt;
+	b->offset[2] = 0;
+	while (b->offset[2] < l)
 	{
-		if (f->buffer_crypt->offset[0] >= f->buffer_crypt->offset[1])
+		size_t z = l - b->offset[2];
+		if (b->offset[0])
 		{
-			memcpy(d + f->buffer_crypt->offset[2], f->buffer_crypt->stream, f->buffer_crypt->offset[1]);
-			f->buffer_crypt->offset[0] -= f->buffer_crypt->offset[1];
-			uint8_t *x = gcry_calloc_secure(f->buffer_crypt->block, sizeof( uint8_t ));
-			if (!x)
-				die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, f->buffer_crypt->block * sizeof( uint8_t ));
-			memcpy(x, f->buffer_crypt->stream + f->buffer_crypt->offset[1], f->buffer_crypt->offset[0]);
-			memset(f->buffer_crypt->stream, 0x00, f->buffer_crypt->block);
-			memcpy(f->buffer_crypt->stream, x, f->buffer_crypt->offset[0]);
-			gcry_free(x);
-			return l;
+			/*
+			 * use up what was decrypted last time
+			 */
+			if (z > b->offset[0])
+				z = b->offset[0];
+			memcpy(d + b->offset[2], b->stream + b->offset[1], z);
+			b->offset[0] -= z;
+			b->offset[1] += z;
+			b->offset[2] += z;
+			continue;
 		}
-
-		memcpy(d + f->buffer_crypt->offset[2], f->buffer_crypt->stream, f->buffer_crypt->offset[0]);
-		f->buffer_crypt->offset[2] += f->buffer_crypt->offset[0];
-		f->buffer_crypt->offset[1] -= f->buffer_crypt->offset[0];
-		f->buffer_crypt->offset[0] = 0;
-
 		ssize_t e = EXIT_SUCCESS;
-		if ((e = ecc_read(f, f->buffer_crypt->stream, f->buffer_crypt->block)) < 0)
+		if (z >= b->block)
+		{
+			/*
+			 * whole blocks can be read directly into the caller’s
+			 * buffer and decrypted in place, all in one go
+			 */
+			z -= z % b->block;
+			if ((e = ecc_read(f, d + b->offset[2], z)) < 0)
+				return e;
+			if ((e -= e % b->block) == 0)
+				break;
+#if !defined __DEBUG__ || defined __DEBUG_WITH_ENCRYPTION__
+			gcry_cipher_decrypt(f->cipher_handle, d + b->offset[2], e, NULL, 0);
+#endif
+			b->offset[2] += e;
+			continue;
+		}
+		if ((e = ecc_read(f, b->stream, b->block)) < 0)
 			return e;
+		if (!e)
+			break;
 #if !defined __DEBUG__ || defined __DEBUG_WITH_ENCRYPTION__
-		gcry_cipher_decrypt(f->cipher_handle, f->buffer_crypt->stream, f->buffer_crypt->block, NULL, 0);
+		gcry_cipher_decrypt(f->cipher_handle, b->stream, b->block, NULL, 0);
 #endif
-		f->buffer_crypt->offset[0] = f->buffer_crypt->block;
+		b->offset[0] = b->block;
+		b->offset[1] = 0;
 	}
+	return b->offset[2];
 }
 
 static int enc_sync(io_private_t *f)
@@ -681,15 +2018,589 @@ static int enc_sync(io_private_t *f)
 	return 0;
 }
 
-static ssize_t ecc_write(io_private_t *f, const void *d, size_t l)
+/*
+ * since 2026.10 the data is split into chunks, each with its own IV
+ * (derived from the one in the header) and MAC; full chunks can then be
+ * handled by a pool of threads, while this thread writes/reads them in
+ * order; the final chunk is marked as such and its MAC also covers the
+ * MACs of all the chunks before it, so it can’t be cut short or reordered
+ */
+static void chunk_init(io_private_t *f, enum gcry_cipher_algos c, enum gcry_md_algos h, enum gcry_cipher_modes m, enum gcry_mac_algos a, const uint8_t *k, size_t kl, const uint8_t *mk, size_t ml, const uint8_t *iv, bool e)
 {
-	if (!f->ecc_init)
-	{
-		if (!d && !l)
-			return fsync(f->fd) , 0;
+	chunk_pool_t *p = calloc(1, sizeof( chunk_pool_t ));
+	if (!p)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, sizeof( chunk_pool_t ));
+	p->cipher = c;
+	p->mode = m;
+	p->mac = a;
+	p->hash = h;
+	p->encrypt = e;
+	p->block = f->buffer_crypt->block;
+	p->tag_length = gcry_mac_get_algo_maclen(a);
+	p->digest_length = gcry_md_get_algo_dlen(h);
+	const char *mac_name = mac_name_from_id(a);
+	p->mac_iv = !strncmp("GMAC", mac_name, strlen("GMAC")) || !strncmp("POLY1305", mac_name, strlen("POLY1305"));
+
+	p->key_length = kl;
+	p->mac_key_length = ml;
+	if (!(p->key = gcry_malloc_secure(kl)) || !(p->mac_key = gcry_malloc_secure(ml)) || !(p->iv = gcry_malloc_secure(p->block)) || !(p->digest = gcry_malloc_secure(p->digest_length)))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, kl + ml + p->block + p->digest_length);
+	memcpy(p->key, k, kl);
+	memcpy(p->mac_key, mk, ml);
+	memcpy(p->iv, iv, p->block);
+	gcry_md_open(&p->tags, h, GCRY_MD_FLAG_SECURE);
+	p->origin = f->consumed;
+
+	p->threads = crypt_threads ? : lzma_cputhreads();
+	if (p->threads < 2)
+		p->threads = 0;
+	/*
+	 * enough chunks to keep every thread busy while the oldest are
+	 * written out/read in
+	 */
+	p->slots = p->threads ? p->threads * 2 : 1;
+	if (!(p->slot = calloc(p->slots, sizeof( chunk_t ))))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, p->slots * sizeof( chunk_t ));
+	for (size_t i = 0; i < p->slots; i++)
+		if (!(p->slot[i].data = malloc(IO_CHUNK_SIZE + p->tag_length)) || !(p->slot[i].tag = malloc(p->tag_length)))
+			die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, IO_CHUNK_SIZE + 2 * p->tag_length);
+
+	if (p->threads)
+	{
+		pthread_mutex_init(&p->mutex, NULL);
+		pthread_cond_init(&p->cond, NULL);
+		if (!(p->thread = calloc(p->threads, sizeof( pthread_t ))))
+			die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, p->threads * sizeof( pthread_t ));
+		for (uint32_t i = 0; i < p->threads; i++)
+			pthread_create(&p->thread[i], NULL, chunk_worker, p);
+	}
+	f->chunks = p;
+	return;
+}
+
+static void *chunk_worker(void *ptr)
+{
+	chunk_pool_t *p = ptr;
+	gcry_cipher_hd_t c;
+	gcry_mac_hd_t m;
+	gcry_cipher_open(&c, p->cipher, p->mode, GCRY_CIPHER_SECURE);
+	gcry_cipher_setkey(c, p->key, p->key_length);
+	gcry_mac_open(&m, p->mac, GCRY_MAC_FLAG_SECURE, NULL);
+	gcry_mac_setkey(m, p->mac_key, p->mac_key_length);
+
+	pthread_mutex_lock(&p->mutex);
+	while (true)
+	{
+		chunk_t *x = NULL;
+		for (size_t i = 0, j = p->tail; i < p->slots && !x; i++, j = (j + 1) % p->slots)
+			if (p->slot[j].state == CHUNK_QUEUED)
+				x = &p->slot[j];
+		if (!x)
+		{
+			if (p->quit)
+				break;
+			pthread_cond_wait(&p->cond, &p->mutex);
+			continue;
+		}
+		x->state = CHUNK_BUSY;
+		pthread_mutex_unlock(&p->mutex);
+		chunk_process(p, c, m, x);
+		pthread_mutex_lock(&p->mutex);
+		x->state = CHUNK_DONE;
+		pthread_cond_broadcast(&p->cond);
+	}
+	pthread_mutex_unlock(&p->mutex);
+
+	gcry_cipher_close(c);
+	gcry_mac_close(m);
+	return NULL;
+}
+
+static void chunk_process(chunk_pool_t *p, gcry_cipher_hd_t c, gcry_mac_hd_t m, chunk_t *x)
+{
+	/*
+	 * the IV is a hash of the original IV and the chunk number
+	 */
+	uint64_t i = htonll(x->index);
+	uint8_t *iv = gcry_calloc_secure(p->block + sizeof i, sizeof( byte_t ));
+	uint8_t *h = gcry_malloc_secure(p->digest_length);
+	if (!iv || !h)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, p->block + sizeof i + p->digest_length);
+	memcpy(iv, p->iv, p->block);
+	memcpy(iv + p->block, &i, sizeof i);
+	gcry_md_hash_buffer(p->hash, h, iv, p->block + sizeof i);
+	memset(iv, 0x00, p->block);
+	memcpy(iv, h, p->block < p->digest_length ? p->block : p->digest_length);
+	gcry_free(h);
+
+	if (p->encrypt && x->length % p->block)
+	{
+		/*
+		 * only the final chunk is ever short; pad it with random data
+		 */
+		size_t z = p->block - x->length % p->block;
+		gcry_create_nonce(x->data + x->length, z);
+		x->length += z;
+	}
+	if (p->mode == GCRY_CIPHER_MODE_CTR)
+		gcry_cipher_setctr(c, iv, p->block);
+	else
+		gcry_cipher_setiv(c, iv, p->block);
+#if !defined __DEBUG__ || defined __DEBUG_WITH_ENCRYPTION__
+	if (p->encrypt)
+		gcry_cipher_encrypt(c, x->data, x->length, NULL, 0);
+#endif
+
+	/*
+	 * MAC the ciphertext, along with its position
+	 */
+	gcry_mac_reset(m);
+	if (p->mac_iv)
+		gcry_mac_setiv(m, iv, p->block);
+	gcry_mac_write(m, &i, sizeof i);
+	uint8_t l = x->last;
+	gcry_mac_write(m, &l, sizeof l);
+	gcry_mac_write(m, x->data, x->length);
+	if (x->last)
+		gcry_mac_write(m, p->digest, p->digest_length);
+	gcry_free(iv);
+	if (p->encrypt)
+	{
+		size_t z = p->tag_length;
+		gcry_mac_read(m, x->tag, &z);
+		return;
+	}
+	x->valid = !(x->length % p->block) && !gcry_mac_verify(m, x->tag, p->tag_length);
+#if !defined __DEBUG__ || defined __DEBUG_WITH_ENCRYPTION__
+	if (x->valid)
+		gcry_cipher_decrypt(c, x->data, x->length, NULL, 0);
+#endif
+	return;
+}
+
+static void chunk_submit(io_private_t *f, chunk_t *x)
+{
+	chunk_pool_t *p = f->chunks;
+	/*
+	 * without workers (and for the final chunk, which needs everything
+	 * before it to have been done) do it now
+	 */
+	if (!p->threads || x->last)
+	{
+		chunk_process(p, f->cipher_handle, f->mac_handle, x);
+		x->state = CHUNK_DONE;
+		return;
+	}
+	pthread_mutex_lock(&p->mutex);
+	x->state = CHUNK_QUEUED;
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->mutex);
+	return;
+}
+
+static ssize_t chunk_emit(io_private_t *f, bool w)
+{
+	/*
+	 * write out, in order, whatever has been encrypted; if asked to,
+	 * wait for (at least) the oldest chunk
+	 */
+	chunk_pool_t *p = f->chunks;
+	while (true)
+	{
+		chunk_t *x = &p->slot[p->tail];
+		chunk_state_e s;
+		if (p->threads)
+		{
+			pthread_mutex_lock(&p->mutex);
+			while (w && (x->state == CHUNK_QUEUED || x->state == CHUNK_BUSY))
+				pthread_cond_wait(&p->cond, &p->mutex);
+			s = x->state; /* (read while no worker can be changing it) */
+			pthread_mutex_unlock(&p->mutex);
+		}
+		else
+			s = x->state;
+		if (s != CHUNK_DONE)
+			return 0;
+		if (ecc_write(f, x->data, x->length) < 0 || ecc_write(f, x->tag, p->tag_length) < 0)
+			return -1;
+		gcry_md_write(p->tags, x->tag, p->tag_length);
+		x->length = 0;
+		x->state = CHUNK_EMPTY;
+		p->tail = (p->tail + 1) % p->slots;
+		w = false;
+	}
+}
+
+static ssize_t chunk_write(io_private_t *f, const void *d, size_t l)
+{
+	chunk_pool_t *p = f->chunks;
+	for (size_t t = 0; t < l; )
+	{
+		chunk_t *x = &p->slot[p->head];
+		if (x->state != CHUNK_EMPTY)
+		{
+			if (chunk_emit(f, true) < 0)
+				return -1;
+			continue;
+		}
+		if (x->length == IO_CHUNK_SIZE)
+		{
+			/*
+			 * only now that there’s more is it known that this
+			 * isn’t the final chunk (which is never empty, so
+			 * reading the last of the data always verifies it)
+			 */
+			x->index = p->index++;
+			x->last = false;
+			chunk_submit(f, x);
+			p->head = (p->head + 1) % p->slots;
+			if (chunk_emit(f, false) < 0)
+				return -1;
+			continue;
+		}
+		size_t z = IO_CHUNK_SIZE - x->length;
+		if (z > l - t)
+			z = l - t;
+		memcpy(x->data + x->length, d + t, z);
+		x->length += z;
+		t += z;
+	}
+	return l;
+}
+
+static int chunk_sync(io_private_t *f)
+{
+	chunk_pool_t *p = f->chunks;
+	if (p->eof)
+		return 0;
+	while (p->tail != p->head || p->slot[p->head].state != CHUNK_EMPTY)
+		if (chunk_emit(f, true) < 0)
+			return -1;
+	chunk_t *x = &p->slot[p->head];
+	x->index = p->index++;
+	x->last = true;
+	memcpy(p->digest, gcry_md_read(p->tags, p->hash), p->digest_length);
+	chunk_submit(f, x);
+	p->eof = true;
+	int e = chunk_emit(f, false) < 0 ? -1 : 0;
+	ecc_sync(f);
+	return e;
+}
+
+static ssize_t chunk_fill(io_private_t *f)
+{
+	/*
+	 * read ahead as many chunks as there’s room for; a chunk is the
+	 * last one if it’s short, or there’s nothing after it
+	 */
+	chunk_pool_t *p = f->chunks;
+	while (!p->eof)
+	{
+		chunk_t *x = &p->slot[p->head];
+		if (x->state != CHUNK_EMPTY)
+			break;
+		if (p->detached)
+		{
+			/*
+			 * after a seek every chunk is read from where it is,
+			 * which also says which one is last
+			 */
+			int e = chunk_fetch(f, x, p->index);
+			if (e < 0)
+				return p->eof = true , -1;
+			if (!e)
+			{
+				p->eof = true;
+				break;
+			}
+			x->offset = p->skip < x->length ? p->skip : x->length;
+			p->skip = 0;
+			p->index++;
+			p->head = (p->head + 1) % p->slots;
+			p->eof = x->last;
+			chunk_submit(f, x);
+			continue;
+		}
+		size_t o = 0;
+		if (p->peeked)
+		{
+			x->data[0] = p->peek;
+			o = sizeof p->peek;
+			p->peeked = false;
+		}
+		ssize_t e = ecc_read(f, x->data + o, IO_CHUNK_SIZE + p->tag_length - o);
+		if (e < 0)
+			return e;
+		e += o;
+		if ((size_t)e < p->tag_length)
+			return p->eof = true , errno = EBADMSG , -1;
+		if (!(x->last = (size_t)e < IO_CHUNK_SIZE + p->tag_length))
+		{
+			ssize_t y = ecc_read(f, &p->peek, sizeof p->peek);
+			if (y < 0)
+				return y;
+			p->peeked = y > 0;
+			x->last = !p->peeked;
+		}
+		x->length = e - p->tag_length;
+		x->offset = 0;
+		memcpy(x->tag, x->data + x->length, p->tag_length);
+		x->index = p->index++;
+		p->head = (p->head + 1) % p->slots;
+		if ((p->eof = x->last))
+		{
+			memcpy(p->digest, gcry_md_read(p->tags, p->hash), p->digest_length);
+			p->digested = true;
+		}
+		else
+			gcry_md_write(p->tags, x->tag, p->tag_length);
+		chunk_submit(f, x);
+	}
+	return 0;
+}
+
+static ssize_t chunk_read(io_private_t *f, void *d, size_t l)
+{
+	chunk_pool_t *p = f->chunks;
+	size_t r = 0;
+	while (r < l)
+	{
+		if (chunk_fill(f) < 0)
+			return -1;
+		chunk_t *x = &p->slot[p->tail];
+		if (p->threads)
+		{
+			pthread_mutex_lock(&p->mutex);
+			while (x->state == CHUNK_QUEUED || x->state == CHUNK_BUSY)
+				pthread_cond_wait(&p->cond, &p->mutex);
+			pthread_mutex_unlock(&p->mutex);
+		}
+		if (x->state != CHUNK_DONE)
+			break;
+		if (!x->valid)
+			return errno = EBADMSG , -1;
+		size_t z = x->length - x->offset;
+		if (z > l - r)
+			z = l - r;
+		memcpy(d + r, x->data + x->offset, z);
+		x->offset += z;
+		r += z;
+		if (x->offset == x->length)
+		{
+			x->length = 0;
+			x->state = CHUNK_EMPTY;
+			p->tail = (p->tail + 1) % p->slots;
+		}
+	}
+	return r;
+}
+
+static void chunk_end(io_private_t *f)
+{
+	chunk_pool_t *p = f->chunks;
+	if (p->threads)
+	{
+		pthread_mutex_lock(&p->mutex);
+		p->quit = true;
+		pthread_cond_broadcast(&p->cond);
+		pthread_mutex_unlock(&p->mutex);
+		for (uint32_t i = 0; i < p->threads; i++)
+			pthread_join(p->thread[i], NULL);
+		free(p->thread);
+		pthread_cond_destroy(&p->cond);
+		pthread_mutex_destroy(&p->mutex);
+	}
+	for (size_t i = 0; i < p->slots; i++)
+	{
+		memset(p->slot[i].data, 0x00, IO_CHUNK_SIZE + p->tag_length);
+		free(p->slot[i].data);
+		free(p->slot[i].tag);
+	}
+	free(p->slot);
+	gcry_md_close(p->tags);
+	gcry_free(p->key);
+	gcry_free(p->mac_key);
+	gcry_free(p->iv);
+	gcry_free(p->digest);
+	free(p);
+	f->chunks = NULL;
+	return;
+}
+
+/*
+ * where, in the plaintext, the next chunk_read() will start (or the
+ * next chunk_write() will go)
+ */
+static int64_t chunk_position(io_private_t *f)
+{
+	chunk_pool_t *p = f->chunks;
+	if (p->encrypt)
+	{
+		chunk_t *x = &p->slot[p->head];
+		return p->index * IO_CHUNK_SIZE + (x->state == CHUNK_EMPTY ? x->length : 0);
+	}
+	chunk_t *x = &p->slot[p->tail];
+	if (x->state != CHUNK_EMPTY)
+		return x->index * IO_CHUNK_SIZE + x->offset;
+	return p->index * IO_CHUNK_SIZE;
+}
+
+/*
+ * how many chunks there are, and how much (error corrected) data they
+ * take up
+ */
+static int64_t chunk_count(io_private_t *f, uint64_t *t)
+{
+	chunk_pool_t *p = f->chunks;
+	int64_t s = ecc_size(f);
+	if (s < 0)
+		return -1;
+	*t = (uint64_t)s > p->origin ? (uint64_t)s - p->origin : 0;
+	return (*t + IO_CHUNK_SIZE + p->tag_length - 1) / (IO_CHUNK_SIZE + p->tag_length);
+}
+
+/*
+ * the final chunk’s MAC covers the tags of all the chunks before it;
+ * they’re at known offsets, so only they need to be read
+ */
+static int chunk_digest(io_private_t *f, uint64_t n)
+{
+	chunk_pool_t *p = f->chunks;
+	size_t b = IO_CHUNK_SIZE + p->tag_length;
+	uint8_t *t = malloc(p->tag_length);
+	if (!t)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, p->tag_length);
+	gcry_md_hd_t h;
+	gcry_md_open(&h, p->hash, GCRY_MD_FLAG_SECURE);
+	int e = 0;
+	for (uint64_t i = 0; i < n && !e; i++)
+		if (ecc_pread(f, t, p->tag_length, p->origin + i * b + IO_CHUNK_SIZE) == (ssize_t)p->tag_length)
+			gcry_md_write(h, t, p->tag_length);
+		else
+			e = -1;
+	if (!e)
+	{
+		memcpy(p->digest, gcry_md_read(h, p->hash), p->digest_length);
+		p->digested = true;
+	}
+	gcry_md_close(h);
+	free(t);
+	return e;
+}
+
+/*
+ * read a chunk (as yet unauthenticated) from where it is; as every
+ * chunk but the last is the same size, that is simple arithmetic;
+ * returns 0 if there’s no such chunk
+ */
+static int chunk_fetch(io_private_t *f, chunk_t *x, uint64_t i)
+{
+	chunk_pool_t *p = f->chunks;
+	size_t b = IO_CHUNK_SIZE + p->tag_length;
+	uint64_t t;
+	int64_t n = chunk_count(f, &t);
+	if (n < 0)
+		return -1;
+	if (i >= (uint64_t)n)
+		return 0;
+	x->index = i;
+	x->last = i == (uint64_t)n - 1;
+	x->offset = 0;
+	size_t y = x->last ? t - i * b : b;
+	if (y < p->tag_length || (x->last && !p->digested && chunk_digest(f, i) < 0))
+		return errno = EBADMSG , -1;
+	ssize_t e = ecc_pread(f, x->data, y, p->origin + i * b);
+	if (e < 0)
+		return -1;
+	if ((size_t)e != y)
+		return errno = EBADMSG , -1;
+	x->length = y - p->tag_length;
+	memcpy(x->tag, x->data + x->length, p->tag_length);
+	return 1;
+}
+
+/*
+ * read (and authenticate) only the chunks which cover the requested
+ * range, leaving everything else as it was
+ */
+static ssize_t chunk_pread(io_private_t *f, void *d, size_t l, uint64_t o)
+{
+	chunk_pool_t *p = f->chunks;
+	chunk_t x = { 0 };
+	if (!(x.data = malloc(IO_CHUNK_SIZE + p->tag_length)) || !(x.tag = malloc(p->tag_length)))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, IO_CHUNK_SIZE + 2 * p->tag_length);
+	ssize_t r = 0;
+	while ((size_t)r < l)
+	{
+		size_t z = (o + r) % IO_CHUNK_SIZE;
+		int e = chunk_fetch(f, &x, (o + r) / IO_CHUNK_SIZE);
+		if (e <= 0)
+		{
+			r = e < 0 ? -1 : r;
+			break;
+		}
+		chunk_process(p, f->cipher_handle, f->mac_handle, &x);
+		if (!x.valid)
+		{
+			r = (errno = EBADMSG , -1);
+			break;
+		}
+		if (z >= x.length)
+			break;
+		size_t y = x.length - z;
+		if (y > l - r)
+			y = l - r;
+		memcpy(d + r, x.data + z, y);
+		r += y;
+	}
+	memset(x.data, 0x00, IO_CHUNK_SIZE + p->tag_length);
+	free(x.data);
+	free(x.tag);
+	return r;
+}
+
+static ssize_t ecc_write(io_private_t *f, const void *d, size_t l)
+{
+	if (!f->stage_ecc && f->ecc_init && io_pipeline)
+		f->stage_ecc = stage_init(f, STAGE_ECC, false);
+	if (f->stage_ecc)
+		return !d && !l ? stage_flush(f->stage_ecc, true) : stage_write(f->stage_ecc, d, l);
+	return ecc_do_write(f, d, l);
+}
+
+static ssize_t ecc_read(io_private_t *f, void *d, size_t l)
+{
+	if (!f->stage_ecc && f->ecc_init && io_pipeline)
+		f->stage_ecc = stage_init(f, STAGE_ECC, true);
+	ssize_t e = f->stage_ecc ? stage_read(f->stage_ecc, d, l) : ecc_do_read(f, d, l);
+	if (e > 0)
+		f->consumed += e;
+	return e;
+}
+
+static int ecc_sync(io_private_t *f)
+{
+	ecc_write(f, NULL, 0);
+	return 0;
+}
+
+static ssize_t ecc_do_write(io_private_t *f, const void *d, size_t l)
+{
+	if (!f->ecc_init)
+	{
+		if (!d && !l)
+			return buf_flush(f) < 0 ? -1 : (fsync(f->fd) , 0);
 		else
-			return write(f->fd, d, l);
+			return buf_write(f, d, l);
 	}
+	/*
+	 * since 2026.11 the codewords are always written a batch at a time
+	 * (by the workers, if there are any)
+	 */
+	if (!f->ecc_pool && (f->correction != IO_CORRECTION_COMPAT || (crypt_threads ? : lzma_cputhreads()) > 1))
+		f->ecc_pool = ecc_pool_init(true, false, f->correction);
+	if (f->ecc_pool)
+		return ecc_pool_write(f, d, l);
 
 	size_t remainder[2] = { l, f->buffer_ecc->block - f->buffer_ecc->offset[0] }; /* 0: length of data yet to buffer (from d); 1: available space in output buffer (stream) */
 	if (!d && !l)
@@ -699,9 +2610,10 @@ static ssize_t ecc_write(io_private_t *f, const void *d, size_t l)
 		memcpy(f->buffer_ecc->stream, tmp, sizeof tmp);
 
 		uint8_t z = (uint8_t)f->buffer_ecc->offset[0];
-		write(f->fd, &z, sizeof z);
-		write(f->fd, f->buffer_ecc->stream, ECC_OFFSET);
-		ssize_t e = write(f->fd, f->buffer_ecc->stream + ECC_OFFSET, ECC_PAYLOAD);
+		buf_write(f, &z, sizeof z);
+		ssize_t e = buf_write(f, f->buffer_ecc->stream, ECC_CAPACITY);
+		if (buf_flush(f) < 0)
+			e = -1;
 
 		fsync(f->fd);
 		f->buffer_ecc->block = 0;
@@ -714,6 +2626,26 @@ static ssize_t ecc_write(io_private_t *f, const void *d, size_t l)
 	f->buffer_ecc->offset[1] = 0;
 	while (remainder[0])
 	{
+		if (!f->buffer_ecc->offset[0] && remainder[0] >= ECC_PAYLOAD)
+		{
+			/*
+			 * whole blocks needn’t be buffered first; encode as many
+			 * as possible at once, each after its length
+			 */
+			uint8_t x[ECC_BATCH * (ECC_CAPACITY + 1)];
+			size_t n = remainder[0] / ECC_PAYLOAD;
+			if (n > ECC_BATCH)
+				n = ECC_BATCH;
+			for (size_t i = 0; i < n; i++)
+				x[i * (ECC_CAPACITY + 1)] = ECC_PAYLOAD;
+			ecc_encode_batch(d + f->buffer_ecc->offset[1], x + 1, n, ECC_CAPACITY + 1);
+			ssize_t e = EXIT_SUCCESS;
+			if ((e = buf_write(f, x, n * (ECC_CAPACITY + 1))) < 0)
+				return e;
+			f->buffer_ecc->offset[1] += n * ECC_PAYLOAD;
+			remainder[0] -= n * ECC_PAYLOAD;
+			continue;
+		}
 		if (remainder[0] < remainder[1])
 		{
 			memcpy(f->buffer_ecc->stream + f->buffer_ecc->offset[0], d + f->buffer_ecc->offset[1], remainder[0]);
@@ -727,9 +2659,9 @@ static ssize_t ecc_write(io_private_t *f, const void *d, size_t l)
 		memcpy(f->buffer_ecc->stream, tmp, sizeof tmp);
 
 		uint8_t z = ECC_PAYLOAD;
-		write(f->fd, &z, sizeof z);
+		buf_write(f, &z, sizeof z);
 		ssize_t e = EXIT_SUCCESS;
-		if ((e = write(f->fd, f->buffer_ecc->stream, ECC_CAPACITY)) < 0)
+		if ((e = buf_write(f, f->buffer_ecc->stream, ECC_CAPACITY)) < 0)
 			return e;
 
 		f->buffer_ecc->offset[0] = 0;
@@ -741,10 +2673,14 @@ static ssize_t ecc_write(io_private_t *f, const void *d, size_t l)
 	return l;
 }
 
-static ssize_t ecc_read(io_private_t *f, void *d, size_t l)
+static ssize_t ecc_do_read(io_private_t *f, void *d, size_t l)
 {
 	if (!f->ecc_init)
-		return read(f->fd, d, l);
+		return buf_read(f, d, l);
+	if (!f->ecc_pool && (f->correction != IO_CORRECTION_COMPAT || (crypt_threads ? : lzma_cputhreads()) > 1))
+		f->ecc_pool = ecc_pool_init(false, false, f->correction);
+	if (f->ecc_pool)
+		return ecc_pool_read(f, d, l);
 
 	f->buffer_ecc->offset[1] = l;
 	f->buffer_ecc->offset[2] = 0;
@@ -770,54 +2706,1825 @@ static ssize_t ecc_read(io_private_t *f, void *d, size_t l)
 		f->buffer_ecc->offset[0] = 0;
 		memset(f->buffer_ecc->stream, 0x00, ECC_CAPACITY);
 
+		/*
+		 * at EOF give back whatever was decoded before getting there
+		 */
 		ssize_t e = EXIT_SUCCESS;
 		uint8_t z;
-		read(f->fd, &z, sizeof z);
-		if ((e = read(f->fd, f->buffer_ecc->stream, ECC_CAPACITY)) <= 0)
-			return e;
+		if ((e = buf_read(f, &z, sizeof z)) <= 0)
+			return e < 0 ? e : (ssize_t)f->buffer_ecc->offset[2];
+		if ((e = buf_read(f, f->buffer_ecc->stream, ECC_CAPACITY)) <= 0)
+			return e < 0 ? e : (ssize_t)f->buffer_ecc->offset[2];
 
-		uint8_t tmp[ECC_CAPACITY] = { 0x0 };
 		int bo;
-		ecc_decode(f->buffer_ecc->stream, tmp, &bo);
+		ecc_decode(f->buffer_ecc->stream, f->buffer_ecc->stream, &bo);
 		if (bo >= 4)
 			return errno = EIO , -1;
-		memcpy(f->buffer_ecc->stream, tmp, z);
 
 		f->buffer_ecc->offset[0] = z;
 	}
 }
 
-static int ecc_sync(io_private_t *f)
+static ecc_pool_t *ecc_pool_init(bool e, bool s, io_correction_e c)
 {
-	ecc_write(f, NULL, 0);
-	return 0;
+	ecc_pool_t *p = calloc(1, sizeof( ecc_pool_t ));
+	if (!p)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, sizeof( ecc_pool_t ));
+	p->encode = e;
+	p->scrub = s;
+	p->correction = c;
+	p->carry = -1;
+	/*
+	 * with only one thread there are no workers; each batch is dealt
+	 * with as soon as it’s ready
+	 */
+	p->threads = crypt_threads ? : lzma_cputhreads();
+	if (p->threads < 2)
+		p->threads = 0;
+	/*
+	 * enough batches to keep every thread busy while the oldest are
+	 * written out/read in
+	 */
+	p->slots = p->threads ? p->threads * 2 : 1;
+	if (!(p->slot = calloc(p->slots, sizeof( ecc_batch_t ))))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, p->slots * sizeof( ecc_batch_t ));
+	for (size_t i = 0; i < p->slots; i++)
+	{
+		if ((e && !(p->slot[i].data = malloc(ECC_POOL_BATCH * ECC_PAYLOAD))) || !(p->slot[i].code = malloc(ECC_POOL_BATCH * ECC_CODEWORD)))
+			die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, (size_t)ECC_POOL_BATCH * (ECC_PAYLOAD + ECC_CODEWORD));
+		/*
+		 * a byte more than a batch is read at a time
+		 */
+		if (c != IO_CORRECTION_COMPAT && !(p->slot[i].frame = malloc(ECC_FRAME + 1)))
+			die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, (size_t)ECC_FRAME + 1);
+		p->slot[i].error = SIZE_MAX;
+	}
+	pthread_mutex_init(&p->mutex, NULL);
+	pthread_cond_init(&p->cond, NULL);
+	if (p->threads && !(p->thread = calloc(p->threads, sizeof( pthread_t ))))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, p->threads * sizeof( pthread_t ));
+	for (uint32_t i = 0; i < p->threads; i++)
+		pthread_create(&p->thread[i], NULL, ecc_pool_worker, p);
+	return p;
 }
 
-static void io_do_compress(io_private_t *io_ptr)
+static void *ecc_pool_worker(void *ptr)
 {
-	lzma_stream l = LZMA_STREAM_INIT;
-	io_ptr->lzma_handle = l;
+	ecc_pool_t *p = ptr;
+	pthread_mutex_lock(&p->mutex);
+	while (true)
+	{
+		ecc_batch_t *x = NULL;
+		for (size_t i = 0, j = p->tail; i < p->slots && !x; i++, j = (j + 1) % p->slots)
+			if (p->slot[j].state == CHUNK_QUEUED)
+				x = &p->slot[j];
+		if (!x)
+		{
+			if (p->quit)
+				break;
+			pthread_cond_wait(&p->cond, &p->mutex);
+			continue;
+		}
+		x->state = CHUNK_BUSY;
+		pthread_mutex_unlock(&p->mutex);
+		ecc_pool_process(p, x);
+		pthread_mutex_lock(&p->mutex);
+		x->state = CHUNK_DONE;
+		pthread_cond_broadcast(&p->cond);
+	}
+	pthread_mutex_unlock(&p->mutex);
+	return NULL;
+}
 
-	lzma_filter lzf[2];
-	lzma_options_lzma lzo;
-	lzma_lzma_preset(&lzo, LZMA_PRESET_DEFAULT);
-	lzf[0].id = LZMA_FILTER_LZMA2;
-	lzf[0].options = &lzo;
-	lzf[1].id = LZMA_VLI_UNKNOWN;
-	if (lzma_stream_encoder(&io_ptr->lzma_handle, lzf, LZMA_CHECK_NONE) != LZMA_OK)
+static void ecc_pool_queue(ecc_pool_t *p, ecc_batch_t *x)
+{
+	if (!p->threads)
+	{
+		ecc_pool_process(p, x);
+		x->state = CHUNK_DONE;
 		return;
-	io_ptr->lzma_init = true;
+	}
+	pthread_mutex_lock(&p->mutex);
+	x->state = CHUNK_QUEUED;
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->mutex);
 	return;
 }
 
-static void io_do_decompress(io_private_t *io_ptr)
+static void ecc_pool_process(ecc_pool_t *p, ecc_batch_t *x)
 {
-	lzma_stream l = LZMA_STREAM_INIT;
-	io_ptr->lzma_handle = l;
+	if (p->encode)
+	{
+		/*
+		 * only full batches are handed to the workers
+		 */
+		for (size_t i = 0; i < ECC_POOL_BATCH; i++)
+			x->code[i * ECC_CODEWORD] = ECC_PAYLOAD;
+		ecc_encode_batch(x->data, x->code + 1, ECC_POOL_BATCH, ECC_CODEWORD);
+		if (p->correction != IO_CORRECTION_COMPAT)
+			x->framed = ecc_frame(p, x, ECC_POOL_BATCH, false);
+		x->length = 0;
+		return;
+	}
+	bool framed = p->correction != IO_CORRECTION_COMPAT;
+	if (framed)
+		ecc_unframe(p, x);
+	size_t n = x->length / ECC_CODEWORD;
+	for (size_t i = 0; i < n; i++)
+	{
+		uint8_t *c = x->code + i * ECC_CODEWORD + 1;
+		/*
+		 * the last codeword, since 2026.11, has its length too, and
+		 * where the rest of its payload would be are zeros
+		 */
+		bool final = framed && x->last && i == n - 1;
+		int bo;
+		if (p->scrub)
+		{
+			/*
+			 * a corrected codeword is encoded again, so that its
+			 * parity is put right too; one that can’t be is left as
+			 * it was
+			 */
+			uint8_t m[ECC_CAPACITY];
+			ecc_decode(c, m, &bo);
+			if (bo < 4 && final && (x->cut || !ecc_final_valid(m, c[-1])))
+				bo = 4;
+			if (bo >= 4)
+				x->failed++;
+			else if (bo)
+				ecc_encode(m, c) , x->corrected++;
+			continue;
+		}
+		ecc_decode(c, c, &bo);
+		if (bo < 4 && final && (x->cut || !ecc_final_valid(c, c[-1])))
+			bo = 4;
+		if (bo >= 4)
+		{
+			x->error = i;
+			break;
+		}
+	}
+	/*
+	 * put back what was corrected, as it was (a codeword cut short is
+	 * left alone)
+	 */
+	if (p->scrub && framed && x->corrected)
+		ecc_frame(p, x, n - x->last, x->last && !x->cut);
+	return;
+}
+
+static ssize_t ecc_pool_emit(io_private_t *f, bool w)
+{
+	/*
+	 * write out, in order, whatever has been encoded; if asked to,
+	 * wait for (at least) the oldest batch
+	 */
+	ecc_pool_t *p = f->ecc_pool;
+	while (true)
+	{
+		ecc_batch_t *x = &p->slot[p->tail];
+		pthread_mutex_lock(&p->mutex);
+		while (w && (x->state == CHUNK_QUEUED || x->state == CHUNK_BUSY))
+			pthread_cond_wait(&p->cond, &p->mutex);
+		/*
+		 * (a worker may still have it, so look while it can’t change)
+		 */
+		chunk_state_e s = x->state;
+		pthread_mutex_unlock(&p->mutex);
+		if (s != CHUNK_DONE)
+			return 0;
+		bool framed = p->correction != IO_CORRECTION_COMPAT;
+		if (buf_write(f, framed ? x->frame : x->code, framed ? x->framed : ECC_POOL_BATCH * ECC_CODEWORD) < 0)
+			return -1;
+		x->state = CHUNK_EMPTY;
+		p->tail = (p->tail + 1) % p->slots;
+		w = false;
+	}
+}
 
+static ssize_t ecc_pool_write(io_private_t *f, const void *d, size_t l)
+{
+	ecc_pool_t *p = f->ecc_pool;
+	if (!d && !l)
+	{
+		/*
+		 * the last of the data (which always ends with a short, maybe
+		 * empty, codeword) is encoded here, once everything before it
+		 * has been written
+		 */
+		while (p->tail != p->head || p->slot[p->head].state != CHUNK_EMPTY)
+			if (ecc_pool_emit(f, true) < 0)
+				return -1;
+		ecc_batch_t *x = &p->slot[p->head];
+		size_t n = x->length / ECC_PAYLOAD;
+		uint8_t z = x->length % ECC_PAYLOAD;
+		for (size_t i = 0; i < n; i++)
+			x->code[i * ECC_CODEWORD] = ECC_PAYLOAD;
+		ecc_encode_batch(x->data, x->code + 1, n, ECC_CODEWORD);
+		uint8_t tmp[ECC_PAYLOAD] = { 0x0 };
+		memcpy(tmp, x->data + n * ECC_PAYLOAD, z);
+		x->code[n * ECC_CODEWORD] = z;
+		ssize_t e;
+		if (p->correction != IO_CORRECTION_COMPAT)
+		{
+			/*
+			 * since 2026.11 the length is part of the last payload
+			 */
+			tmp[z] = z;
+			ecc_encode(tmp, x->code + n * ECC_CODEWORD + 1);
+			e = buf_write(f, x->frame, ecc_frame(p, x, n, true));
+		}
+		else
+		{
+			ecc_encode(tmp, x->code + n * ECC_CODEWORD + 1);
+			e = buf_write(f, x->code, (n + 1) * ECC_CODEWORD);
+		}
+		if (buf_flush(f) < 0)
+			e = -1;
+		fsync(f->fd);
+		ecc_pool_end(f);
+		return e;
+	}
+	for (size_t t = 0; t < l; )
+	{
+		ecc_batch_t *x = &p->slot[p->head];
+		if (x->state != CHUNK_EMPTY)
+		{
+			if (ecc_pool_emit(f, true) < 0)
+				return -1;
+			continue;
+		}
+		size_t z = ECC_POOL_BATCH * ECC_PAYLOAD - x->length;
+		if (z > l - t)
+			z = l - t;
+		memcpy(x->data + x->length, d + t, z);
+		x->length += z;
+		t += z;
+		if (x->length == ECC_POOL_BATCH * ECC_PAYLOAD)
+		{
+			ecc_pool_queue(p, x);
+			p->head = (p->head + 1) % p->slots;
+			if (ecc_pool_emit(f, false) < 0)
+				return -1;
+		}
+	}
+	return l;
+}
+
+static ssize_t ecc_pool_read(io_private_t *f, void *d, size_t l)
+{
+	ecc_pool_t *p = f->ecc_pool;
+	size_t r = 0;
+	while (r < l)
+	{
+		ecc_pool_fill(f);
+		ecc_batch_t *x = &p->slot[p->tail];
+		if (x->state == CHUNK_EMPTY)
+		{
+			/*
+			 * at EOF give back whatever was decoded before getting
+			 * there
+			 */
+			if (p->error)
+				return errno = p->error , -1;
+			break;
+		}
+		pthread_mutex_lock(&p->mutex);
+		while (x->state != CHUNK_DONE)
+			pthread_cond_wait(&p->cond, &p->mutex);
+		pthread_mutex_unlock(&p->mutex);
+		for (; x->current < x->length / ECC_CODEWORD && r < l; x->current++, x->offset = 0)
+		{
+			if (x->current == x->error)
+				return errno = EIO , -1;
+			uint8_t *c = x->code + x->current * ECC_CODEWORD;
+			size_t z = c[0] - x->offset;
+			if (z > l - r)
+			{
+				z = l - r;
+				memcpy(d + r, c + 1 + x->offset, z);
+				x->offset += z;
+				r += z;
+				break;
+			}
+			memcpy(d + r, c + 1 + x->offset, z);
+			r += z;
+		}
+		if (x->current == x->length / ECC_CODEWORD)
+		{
+			x->state = CHUNK_EMPTY;
+			p->tail = (p->tail + 1) % p->slots;
+		}
+	}
+	return r;
+}
+
+/*
+ * read ahead as many batches as there’s room for
+ */
+static void ecc_pool_fill(io_private_t *f)
+{
+	ecc_pool_t *p = f->ecc_pool;
+	while (!p->eof && p->slot[p->head].state == CHUNK_EMPTY)
+	{
+		ecc_batch_t *x = &p->slot[p->head];
+		if (p->correction != IO_CORRECTION_COMPAT)
+		{
+			/*
+			 * since 2026.11 the last batch is known by where the
+			 * file ends, so read a byte more than a batch (and keep
+			 * it for the next)
+			 */
+			size_t c = 0;
+			if (p->carry >= 0)
+				x->frame[c++] = p->carry;
+			ssize_t e = buf_read(f, x->frame + c, ECC_FRAME + 1 - c);
+			if (e < 0)
+			{
+				p->error = errno;
+				p->eof = true;
+				break;
+			}
+			e += c;
+			x->last = e <= ECC_FRAME;
+			p->carry = x->last ? -1 : x->frame[ECC_FRAME];
+			x->framed = x->last ? (size_t)e : ECC_FRAME;
+			p->eof = x->last;
+			x->start = p->read;
+			p->read += x->framed;
+			/*
+			 * there’s always a last codeword
+			 */
+			if (!(x->length = x->framed))
+			{
+				p->error = EIO;
+				break;
+			}
+		}
+		else
+		{
+			ssize_t e = buf_read(f, x->code, ECC_POOL_BATCH * ECC_CODEWORD);
+			if (e < 0)
+			{
+				p->error = errno;
+				p->eof = true;
+				break;
+			}
+			p->eof = e < ECC_POOL_BATCH * ECC_CODEWORD;
+			x->start = p->read;
+			p->read += e;
+			/*
+			 * as ever, a codeword cut short is decoded as best it can
+			 * be, but its length alone is of no use; when scrubbing,
+			 * it’s left as it is
+			 */
+			if (!p->scrub && e % ECC_CODEWORD > 1)
+			{
+				memset(x->code + e, 0x00, ECC_CODEWORD - e % ECC_CODEWORD);
+				e += ECC_CODEWORD - e % ECC_CODEWORD;
+			}
+			x->length = p->scrub ? (size_t)e : (size_t)(e - e % ECC_CODEWORD);
+			if (!x->length)
+				break;
+		}
+		x->offset = 0;
+		x->current = 0;
+		x->error = SIZE_MAX;
+		x->corrected = 0;
+		x->failed = 0;
+		ecc_pool_queue(p, x);
+		p->head = (p->head + 1) % p->slots;
+	}
+	return;
+}
+
+static void ecc_pool_end(io_private_t *f)
+{
+	ecc_pool_t *p = f->ecc_pool;
+	pthread_mutex_lock(&p->mutex);
+	p->quit = true;
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->mutex);
+	for (uint32_t i = 0; i < p->threads; i++)
+		pthread_join(p->thread[i], NULL);
+	free(p->thread);
+	pthread_cond_destroy(&p->cond);
+	pthread_mutex_destroy(&p->mutex);
+	for (size_t i = 0; i < p->slots; i++)
+	{
+		free(p->slot[i].data);
+		free(p->slot[i].code);
+		free(p->slot[i].frame);
+	}
+	free(p->slot);
+	free(p);
+	f->ecc_pool = NULL;
+	return;
+}
+
+/*
+ * since 2026.11 only the last codeword has a length, which is also the
+ * last byte of its payload (so that it’s corrected along with the rest);
+ * the zeros after it aren’t stored:
+ *   [codeword 0][codeword 1]...[payload 0..z][parity]
+ * when interleaved, byte j of codeword i (of the m in a batch) is stored
+ * at j * m + i, spreading a burst across them all
+ */
+static size_t ecc_frame(ecc_pool_t *p, ecc_batch_t *x, size_t m, bool final)
+{
+	for (size_t i = 0; i < m; i++)
+	{
+		const uint8_t *c = x->code + i * ECC_CODEWORD + 1;
+		if (p->correction == IO_CORRECTION_INTERLEAVED)
+			for (size_t j = 0; j < ECC_CAPACITY; j++)
+				x->frame[j * m + i] = c[j];
+		else
+			memcpy(x->frame + i * ECC_CAPACITY, c, ECC_CAPACITY);
+	}
+	size_t b = m * ECC_CAPACITY;
+	if (final)
+	{
+		const uint8_t *c = x->code + m * ECC_CODEWORD;
+		memcpy(x->frame + b, c + 1, c[0] + 1);
+		b += c[0] + 1;
+		memcpy(x->frame + b, c + 1 + ECC_PAYLOAD, ECC_OFFSET);
+		b += ECC_OFFSET;
+	}
+	return b;
+}
+
+static void ecc_unframe(ecc_pool_t *p, ecc_batch_t *x)
+{
+	uint64_t m = ECC_POOL_BATCH;
+	size_t z = 0;
+	if (x->last)
+		z = ecc_final_size(x->framed, &m);
+	for (size_t i = 0; i < m; i++)
+	{
+		uint8_t *c = x->code + i * ECC_CODEWORD;
+		c[0] = ECC_PAYLOAD;
+		if (p->correction == IO_CORRECTION_INTERLEAVED)
+			for (size_t j = 0; j < ECC_CAPACITY; j++)
+				c[j + 1] = x->frame[j * m + i];
+		else
+			memcpy(c + 1, x->frame + i * ECC_CAPACITY, ECC_CAPACITY);
+	}
+	x->length = m * ECC_CODEWORD;
+	x->cut = false;
+	if (!x->last)
+		return;
+	/*
+	 * a last codeword cut short (too short to have been written) is
+	 * replaced by one which can’t be valid, so that it’s reported
+	 */
+	uint8_t *c = x->code + m * ECC_CODEWORD;
+	if (z)
+		ecc_final_load(x->frame + m * ECC_CAPACITY, z, c);
+	else
+		memset(c, 0x00, ECC_CODEWORD) , x->cut = true;
+	x->length += ECC_CODEWORD;
+	return;
+}
+
+/*
+ * given how many bytes there are, how many full codewords come before
+ * the last, and the size of the last (0 if there isn’t room for one)
+ */
+static size_t ecc_final_size(uint64_t b, uint64_t *m)
+{
+	if (!b)
+		return *m = 0 , 0;
+	*m = b % ECC_CAPACITY ? b / ECC_CAPACITY : b / ECC_CAPACITY - 1;
+	size_t f = b - *m * ECC_CAPACITY;
+	return f > ECC_OFFSET ? f : 0;
+}
+
+static void ecc_final_load(const uint8_t *b, size_t f, uint8_t *c)
+{
+	uint8_t z = f - ECC_OFFSET - 1;
+	c[0] = z;
+	memcpy(c + 1, b, z + 1);
+	memset(c + 1 + z + 1, 0x00, ECC_PAYLOAD - z - 1);
+	memcpy(c + 1 + ECC_PAYLOAD, b + z + 1, ECC_OFFSET);
+	return;
+}
+
+static bool ecc_final_valid(const uint8_t *m, uint8_t z)
+{
+	if (z >= ECC_PAYLOAD || m[z] != z)
+		return false;
+	for (size_t i = z + 1; i < ECC_PAYLOAD; i++)
+		if (m[i])
+			return false;
+	return true;
+}
+
+/*
+ * like ecc_do_read() but from anywhere in the (error corrected) data,
+ * without disturbing what’s been read so far; every codeword but the
+ * last is full, so which one holds what is simple arithmetic
+ */
+static ssize_t ecc_pread(io_private_t *f, void *d, size_t l, uint64_t o)
+{
+	if (!f->ecc_init)
+		return buf_pread(f, d, l, f->ecc_start + o);
+	if (f->correction != IO_CORRECTION_COMPAT)
+		return ecc_pread_framed(f, d, l, o);
+
+	size_t r = 0;
+	while (r < l)
+	{
+		uint64_t i = (o + r) / ECC_PAYLOAD;
+		size_t s = (o + r) % ECC_PAYLOAD;
+		uint8_t code[ECC_CAPACITY + 1];
+		ssize_t e = buf_pread(f, code, sizeof code, f->ecc_start + i * sizeof code);
+		if (e < 0)
+			return -1;
+		if ((size_t)e < sizeof code || code[0] <= s)
+			break;
+
+		int bo;
+		ecc_decode(code + 1, code + 1, &bo);
+		if (bo >= 4)
+			return errno = EIO , -1;
+		size_t z = code[0] - s;
+		if (z > l - r)
+			z = l - r;
+		memcpy(d + r, code + 1 + s, z);
+		r += z;
+		if (code[0] < ECC_PAYLOAD)
+			break;
+	}
+	return r;
+}
+
+/*
+ * as above, but since 2026.11; the number of full codewords (and where
+ * the last one is) comes from the size of the file, and, if they’re
+ * interleaved, a whole batch is read (and kept) to get at any of them
+ */
+static ssize_t ecc_pread_framed(io_private_t *f, void *d, size_t l, uint64_t o)
+{
+	struct stat st;
+	if (fstat(f->fd, &st) < 0)
+		return -1;
+	if (st.st_size <= f->ecc_start)
+		return errno = EIO , -1;
+	uint64_t m;
+	size_t b = ecc_final_size(st.st_size - f->ecc_start, &m);
+	if (!b)
+		return errno = EIO , -1;
+
+	size_t r = 0;
+	while (r < l)
+	{
+		uint64_t i = (o + r) / ECC_PAYLOAD;
+		size_t s = (o + r) % ECC_PAYLOAD;
+		if (i > m)
+			break;
+		uint8_t code[ECC_CODEWORD];
+		if (i == m)
+		{
+			uint8_t tmp[ECC_CAPACITY];
+			if (buf_pread(f, tmp, b, f->ecc_start + m * ECC_CAPACITY) != (ssize_t)b)
+				return errno = EIO , -1;
+			ecc_final_load(tmp, b, code);
+		}
+		else if (f->correction == IO_CORRECTION_INTERLEAVED)
+		{
+			uint64_t g = i / ECC_POOL_BATCH;
+			size_t n = (g + 1) * ECC_POOL_BATCH <= m ? ECC_POOL_BATCH : m - g * ECC_POOL_BATCH;
+			if (f->ecc_cached != g + 1)
+			{
+				if (!f->ecc_cache && !(f->ecc_cache = malloc(ECC_FRAME)))
+					die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, (size_t)ECC_FRAME);
+				if (buf_pread(f, f->ecc_cache, n * ECC_CAPACITY, f->ecc_start + g * ECC_FRAME) != (ssize_t)(n * ECC_CAPACITY))
+					return errno = EIO , -1;
+				f->ecc_cached = g + 1;
+			}
+			code[0] = ECC_PAYLOAD;
+			for (size_t j = 0; j < ECC_CAPACITY; j++)
+				code[j + 1] = f->ecc_cache[j * n + i % ECC_POOL_BATCH];
+		}
+		else
+		{
+			code[0] = ECC_PAYLOAD;
+			if (buf_pread(f, code + 1, ECC_CAPACITY, f->ecc_start + i * ECC_CAPACITY) != ECC_CAPACITY)
+				return errno = EIO , -1;
+		}
+
+		int bo;
+		ecc_decode(code + 1, code + 1, &bo);
+		if (bo < 4 && i == m && !ecc_final_valid(code + 1, code[0]))
+			bo = 4;
+		if (bo >= 4)
+			return errno = EIO , -1;
+		if (code[0] <= s)
+			break;
+		size_t z = code[0] - s;
+		if (z > l - r)
+			z = l - r;
+		memcpy(d + r, code + 1 + s, z);
+		r += z;
+		if (code[0] < ECC_PAYLOAD)
+			break;
+	}
+	return r;
+}
+
+/*
+ * how much (error corrected) data there is in total; the length of the
+ * final codeword is all that isn’t known from the size of the file
+ */
+static int64_t ecc_size(io_private_t *f)
+{
+	struct stat s;
+	if (fstat(f->fd, &s) < 0)
+		return -1;
+	if (s.st_size < f->ecc_start)
+		return 0;
+	if (!f->ecc_init)
+		return s.st_size - f->ecc_start;
+	if (f->correction != IO_CORRECTION_COMPAT)
+	{
+		uint64_t m;
+		size_t b = ecc_final_size(s.st_size - f->ecc_start, &m);
+		if (!b)
+			return errno = EIO , -1;
+		return m * ECC_PAYLOAD + b - ECC_OFFSET - 1;
+	}
+
+	uint64_t n = (s.st_size - f->ecc_start) / (ECC_CAPACITY + 1);
+	if (!n)
+		return 0;
+	uint8_t z;
+	if (buf_pread(f, &z, sizeof z, f->ecc_start + (n - 1) * (ECC_CAPACITY + 1)) != sizeof z)
+		return -1;
+	return (n - 1) * ECC_PAYLOAD + (z < ECC_PAYLOAD ? z : ECC_PAYLOAD);
+}
+
+/*
+ * the bottom of the stack: everything written (ECC length bytes and
+ * codewords, cipher blocks or plain data) is staged here so that it
+ * reaches the file descriptor in large writes instead of one syscall
+ * per block
+ */
+static void buf_init(io_private_t *f)
+{
+	if (!(f->buffer_io = malloc(sizeof( buffer_t ))))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, sizeof( buffer_t ));
+	f->buffer_io->block = io_buffer_size;
+	f->buffer_io->stream = buf_alloc(f->buffer_io->block);
+	/*
+	 * an instance is either read from or written to, never both:
+	 *   0: length of data staged so far, yet to write (in stream)
+	 *   1: length of data read ahead (in stream)
+	 *   2: offset of the next read ahead byte to give out
+	 */
+	for (unsigned i = 0; i < OFFSET_SLOTS; i++)
+		f->buffer_io->offset[i] = 0;
+	return;
+}
+
+static ssize_t buf_write(io_private_t *f, const void *d, size_t l)
+{
+#ifdef HAVE_LIBURING
+	if (f->uring)
+		return uring_write(f, d, l);
+	/*
+	 * with --pipeline too, find out from the first write whether the
+	 * ring comes up; if it doesn’t, the disk thread is used instead
+	 */
+	if (io_uring_wanted && io_pipeline && !f->uring_tried)
+	{
+		f->uring_tried = true;
+		if (uring_init(f, false))
+			return uring_write(f, d, l);
+	}
+#endif
+	if (!f->stage_io && io_pipeline)
+		f->stage_io = stage_init(f, STAGE_IO, false);
+	if (f->stage_io)
+		return stage_write(f->stage_io, d, l);
+	if (!f->buffer_io)
+		buf_init(f);
+	buffer_t *b = f->buffer_io;
+	if (b->offset[0] + l < b->block)
+	{
+		memcpy(b->stream + b->offset[0], d, l);
+		b->offset[0] += l;
+		return l;
+	}
+#ifdef HAVE_LIBURING
+	if (io_uring_wanted && !f->uring_tried)
+	{
+		/*
+		 * there’s now more than a buffer’s worth, so it’s worth
+		 * keeping several writes in flight; start with whatever has
+		 * been staged so far
+		 */
+		f->uring_tried = true;
+		if (uring_init(f, false))
+		{
+			size_t z = b->offset[0];
+			b->offset[0] = 0;
+			if (uring_write(f, b->stream, z) < 0)
+				return -1;
+			return uring_write(f, d, l);
+		}
+	}
+#endif
+	if (l < b->block || f->direct)
+	{
+		/*
+		 * top up the buffer, write it out, and stage what’s left;
+		 * with O_DIRECT everything has to go through the (aligned)
+		 * buffer, so keep going until it all fits
+		 */
+		size_t t = 0;
+		while (b->offset[0] + (l - t) >= b->block)
+		{
+			size_t z = b->block - b->offset[0];
+			memcpy(b->stream + b->offset[0], d + t, z);
+			b->offset[0] = b->block;
+			if (buf_flush(f) < 0)
+				return -1;
+			t += z;
+		}
+		memcpy(b->stream + b->offset[0], d + t, l - t);
+		b->offset[0] += l - t;
+		return l;
+	}
+	/*
+	 * the data is larger than the buffer, so rather than copy it, write
+	 * whatever is already staged along with it
+	 */
+#ifndef _WIN32
+	struct iovec v[2] = { { b->stream, b->offset[0] }, { (void *)d, l } };
+	struct iovec *vp = v;
+	int vc = 2;
+	if (!b->offset[0])
+		vp++ , vc--;
+	while (vc)
+	{
+		ssize_t e = writev(f->fd, vp, vc);
+		if (e < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		for (; vc && (size_t)e >= vp->iov_len; vp++ , vc--)
+			e -= vp->iov_len;
+		if (vc)
+		{
+			vp->iov_base = (uint8_t *)vp->iov_base + e;
+			vp->iov_len -= e;
+		}
+	}
+	b->offset[0] = 0;
+	cache_update(f, true);
+#else
+	if (buf_flush(f) < 0)
+		return -1;
+	for (size_t t = 0; t < l; )
+	{
+		ssize_t e = write(f->fd, d + t, l - t);
+		if (e < 0)
+			return -1;
+		t += e;
+	}
+#endif
+	return l;
+}
+
+/*
+ * the counterpart to buf_write(): fill the buffer a chunk at a time and
+ * serve the ECC and cipher layers from memory; only a short count (ie
+ * end of file) ends a read early
+ */
+static ssize_t buf_read(io_private_t *f, void *d, size_t l)
+{
+	if (io_mmap && !f->map_tried)
+		map_init(f);
+	if (f->map)
+		return map_read(f, d, l);
+#ifdef HAVE_LIBURING
+	if (io_uring_wanted && !f->uring_tried)
+		f->uring_tried = true , uring_init(f, true);
+	if (f->uring)
+		return uring_read(f, d, l);
+#endif
+	if (!f->stage_io && io_pipeline)
+		f->stage_io = stage_init(f, STAGE_IO, true);
+	if (f->stage_io)
+		return stage_read(f->stage_io, d, l);
+	if (!f->buffer_io)
+		buf_init(f);
+	buffer_t *b = f->buffer_io;
+	size_t r = 0;
+	while (r < l)
+	{
+		size_t z = b->offset[1] - b->offset[2];
+		if (z)
+		{
+			if (z > l - r)
+				z = l - r;
+			memcpy(d + r, b->stream + b->offset[2], z);
+			b->offset[2] += z;
+			r += z;
+			continue;
+		}
+		ssize_t e;
+		if (l - r >= b->block && !f->direct)
+		{
+			/*
+			 * no point buffering something this big, read (whole
+			 * chunks of) it directly
+			 */
+			if ((e = read(f->fd, d + r, (l - r) - (l - r) % b->block)) < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return r ? (ssize_t)r : -1;
+			}
+			if (!e)
+				break;
+			r += e;
+			cache_update(f, false);
+			continue;
+		}
+		b->offset[1] = 0;
+		b->offset[2] = 0;
+		if ((e = read(f->fd, b->stream, b->block)) < 0)
+		{
+			if (errno == EINTR || (errno == EINVAL && direct_off(f)))
+				continue;
+			return r ? (ssize_t)r : -1;
+		}
+		if (!e)
+			break;
+		b->offset[1] = e;
+		cache_update(f, false);
+	}
+	return r;
+}
+
+static int buf_flush(io_private_t *f)
+{
+#ifdef HAVE_LIBURING
+	if (f->uring)
+		return uring_flush(f);
+#endif
+	if (f->stage_io)
+		return stage_flush(f->stage_io, false);
+	buffer_t *b = f->buffer_io;
+	if (!b || !b->offset[0])
+		return 0;
+	if (buf_write_all(f, b->stream, b->offset[0]) < 0)
+		return -1;
+	b->offset[0] = 0;
+	return 0;
+}
+
+static ssize_t buf_write_all(io_private_t *f, const void *d, size_t l)
+{
+	for (size_t t = 0; t < l; )
+	{
+		ssize_t e = write(f->fd, d + t, l - t);
+		if (e < 0)
+		{
+			if (errno == EINTR || (errno == EINVAL && direct_off(f)))
+				continue;
+			return -1;
+		}
+		t += e;
+	}
+	cache_update(f, true);
+	return l;
+}
+
+/*
+ * fill as much as possible; only a short count (ie end of file) ends it
+ * early
+ */
+static ssize_t buf_read_all(io_private_t *f, void *d, size_t l)
+{
+	size_t r = 0;
+	while (r < l)
+	{
+		ssize_t e = read(f->fd, d + r, l - r);
+		if (e < 0)
+		{
+			if (errno == EINTR || (errno == EINVAL && direct_off(f)))
+				continue;
+			return r ? (ssize_t)r : -1;
+		}
+		if (!e)
+			break;
+		r += e;
+	}
+	cache_update(f, false);
+	return r;
+}
+
+/*
+ * as above, but from anywhere in the file, leaving the offset alone
+ */
+static ssize_t buf_pread(io_private_t *f, void *d, size_t l, off_t o)
+{
+	size_t r = 0;
+	while (r < l)
+	{
+		ssize_t e = pread(f->fd, d + r, l - r, o + r);
+		if (e < 0)
+		{
+			if (errno == EINTR || (errno == EINVAL && direct_off(f)))
+				continue;
+			return r ? (ssize_t)r : -1;
+		}
+		if (!e)
+			break;
+		r += e;
+	}
+	return r;
+}
+
+/*
+ * buffers which reach the file descriptor have to be aligned for
+ * O_DIRECT
+ */
+static void *buf_alloc(size_t l)
+{
+	void *p = NULL;
+#ifdef O_DIRECT
+	if (posix_memalign(&p, IO_DIRECT_ALIGN, l))
+		p = NULL;
+#else
+	p = malloc(l);
+#endif
+	if (!p)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, l);
+	return p;
+}
+
+static int64_t direct_open(int d, const char *n, int f, mode_t m)
+{
+#ifdef O_DIRECT
+	if (io_direct)
+	{
+		int64_t fd = openat(d, n, f | O_DIRECT, m);
+		if (fd >= 0 || errno != EINVAL)
+			return fd;
+		/*
+		 * the file system doesn’t support it; open as usual
+		 */
+	}
+#endif
+	return openat(d, n, f, m);
+}
+
+/*
+ * O_DIRECT needs everything aligned, which the end of a file (or a
+ * seek) seldom is; when the kernel refuses, carry on without it
+ */
+static bool direct_off(io_private_t *f)
+{
+#ifdef O_DIRECT
+	int x;
+	if (!f->direct || (x = fcntl(f->fd, F_GETFL)) < 0)
+		return false;
+	f->direct = false;
+	return fcntl(f->fd, F_SETFL, x & ~O_DIRECT) == 0;
+#else
+	(void)f;
+	return false;
+#endif
+}
+
+static void cache_update(io_private_t *f, bool w)
+{
+	if (io_drop_cache)
+		cache_advise(f, lseek(f->fd, 0, SEEK_CUR), w);
+	return;
+}
+
+/*
+ * keep a large job from filling the page cache (and pushing out
+ * everyone else’s) with data that will never be looked at again: once
+ * reading has moved on, drop what was read and ask for what’s next;
+ * when writing, start writeback of each window as it fills, then wait
+ * for the one before it and drop that
+ */
+static void cache_advise(io_private_t *f, off_t e, bool w)
+{
+	if (e < 0)
+		return;
+	if (!f->cache_used)
+	{
+		f->cache_used = true;
+		f->cache_write = w;
+#ifdef POSIX_FADV_SEQUENTIAL
+		if (!w)
+			posix_fadvise(f->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	}
+	if (e - f->cache_done < IO_CACHE_WINDOW)
+		return;
+	if (w)
+	{
+#ifdef SYNC_FILE_RANGE_WRITE
+		sync_file_range(f->fd, f->cache_done, e - f->cache_done, SYNC_FILE_RANGE_WRITE);
+		if (f->cache_done > f->cache_previous)
+			sync_file_range(f->fd, f->cache_previous, f->cache_done - f->cache_previous, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+#ifdef POSIX_FADV_DONTNEED
+		if (f->cache_done > f->cache_previous)
+			posix_fadvise(f->fd, f->cache_previous, f->cache_done - f->cache_previous, POSIX_FADV_DONTNEED);
+#endif
+	}
+	else
+	{
+#ifdef POSIX_FADV_DONTNEED
+		posix_fadvise(f->fd, f->cache_done, e - f->cache_done, POSIX_FADV_DONTNEED);
+		posix_fadvise(f->fd, e, IO_CACHE_WINDOW, POSIX_FADV_WILLNEED);
+#endif
+	}
+	f->cache_previous = f->cache_done;
+	f->cache_done = e;
+	return;
+}
+
+/*
+ * whatever’s left: the tail of the output has to be written back
+ * before it can be dropped
+ */
+static void cache_end(io_private_t *f)
+{
+	if (!io_drop_cache || !f->cache_used)
+		return;
+#ifdef SYNC_FILE_RANGE_WRITE
+	if (f->cache_write)
+		sync_file_range(f->fd, f->cache_previous, 0, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+#ifdef POSIX_FADV_DONTNEED
+	posix_fadvise(f->fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+	return;
+}
+
+/*
+ * map the whole of a (regular, read only) file so it can be read from
+ * directly, without first being copied into a buffer
+ */
+static bool map_init(io_private_t *f)
+{
+	f->map_tried = true;
+#ifndef _WIN32
+	struct stat s;
+	int x = fcntl(f->fd, F_GETFL);
+	if (x < 0 || (x & O_ACCMODE) != O_RDONLY || fstat(f->fd, &s) < 0 || !S_ISREG(s.st_mode) || s.st_size <= 0 || (uint64_t)s.st_size > SIZE_MAX)
+		return false;
+	off_t p = lseek(f->fd, 0, SEEK_CUR);
+	if (p < 0 || p > s.st_size)
+		return false;
+	void *m = mmap(NULL, s.st_size, PROT_READ, MAP_SHARED, f->fd, 0);
+	if (m == MAP_FAILED)
+		return false;
+	madvise(m, s.st_size, MADV_SEQUENTIAL);
+	f->map = m;
+	f->map_size = s.st_size;
+	f->map_offset = p;
+	f->map_dropped = 0;
+	return true;
+#else
+	return false;
+#endif
+}
+
+static ssize_t map_read(io_private_t *f, void *d, size_t l)
+{
+	map_release(f);
+	if (f->map_offset >= f->map_size)
+		return 0;
+	if (l > f->map_size - f->map_offset)
+		l = f->map_size - f->map_offset;
+	memcpy(d, f->map + f->map_offset, l);
+	f->map_offset += l;
+	return l;
+}
+
+/*
+ * everything before the current offset has been handed out, and is done
+ * with; let go of it a window at a time
+ */
+static void map_release(io_private_t *f)
+{
+#ifndef _WIN32
+	size_t e = f->map_offset & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+	if (e < f->map_dropped + IO_CACHE_WINDOW)
+		return;
+	madvise(f->map + f->map_dropped, e - f->map_dropped, MADV_DONTNEED);
+	if (io_drop_cache)
+		cache_advise(f, e, false);
+	f->map_dropped = e;
+#else
+	(void)f;
+#endif
+	return;
+}
+
+/*
+ * in pipeline mode the ECC layer and the reading/writing of the file
+ * each run on their own thread, so that the disk, error correction and
+ * the layers above (on the caller’s thread) can all be busy at once;
+ * the data is the same as it would otherwise be
+ */
+static stage_t *stage_init(io_private_t *f, stage_e y, bool r)
+{
+	stage_t *s = calloc(1, sizeof( stage_t ));
+	if (!s)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, sizeof( stage_t ));
+	s->blocks = IO_STAGE_BLOCKS;
+	s->size = io_buffer_size;
+	s->reading = r;
+	s->layer = y;
+	s->io = f;
+	if (!(s->block = calloc(s->blocks, sizeof( stage_block_t ))))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, s->blocks * sizeof( stage_block_t ));
+	for (size_t i = 0; i < s->blocks; i++)
+		s->block[i].data = buf_alloc(s->size);
+	pthread_mutex_init(&s->mutex, NULL);
+	pthread_cond_init(&s->cond, NULL);
+	pthread_create(&s->thread, NULL, stage_worker, s);
+	return s;
+}
+
+static void *stage_worker(void *ptr)
+{
+	stage_t *s = ptr;
+	io_private_t *f = s->io;
+	while (!__atomic_load_n(&s->quit, __ATOMIC_SEQ_CST))
+	{
+		if (s->reading)
+		{
+			/*
+			 * read ahead into the next free block
+			 */
+			size_t t;
+			if (s->head - (t = __atomic_load_n(&s->tail, __ATOMIC_SEQ_CST)) >= s->blocks)
+			{
+				stage_wait(s, &s->tail, t);
+				continue;
+			}
+			stage_block_t *b = &s->block[s->head % s->blocks];
+			ssize_t e = s->layer == STAGE_ECC ? ecc_do_read(f, b->data, s->size) : buf_read_all(f, b->data, s->size);
+			b->offset = 0;
+			b->length = e < 0 ? 0 : e;
+			b->error = e < 0 ? errno : 0;
+			b->eof = e < (ssize_t)s->size;
+			__atomic_store_n(&s->head, s->head + 1, __ATOMIC_SEQ_CST);
+			stage_wake(s);
+			if (b->eof)
+				break;
+		}
+		else
+		{
+			/*
+			 * write out the oldest block handed over; after a
+			 * failure just keep things moving
+			 */
+			size_t h;
+			if ((h = __atomic_load_n(&s->head, __ATOMIC_SEQ_CST)) == s->tail)
+			{
+				stage_wait(s, &s->head, h);
+				continue;
+			}
+			stage_block_t *b = &s->block[s->tail % s->blocks];
+			if (!__atomic_load_n(&s->error, __ATOMIC_SEQ_CST))
+			{
+				ssize_t e = 0;
+				if (b->length)
+					e = s->layer == STAGE_ECC ? ecc_do_write(f, b->data, b->length) : buf_write_all(f, b->data, b->length);
+				if (e >= 0 && b->sync)
+					e = ecc_do_write(f, NULL, 0);
+				if (e < 0)
+					__atomic_store_n(&s->error, errno ? : EIO, __ATOMIC_SEQ_CST);
+			}
+			b->length = 0;
+			b->sync = false;
+			__atomic_store_n(&s->tail, s->tail + 1, __ATOMIC_SEQ_CST);
+			stage_wake(s);
+		}
+	}
+	return NULL;
+}
+
+static void stage_wait(stage_t *s, const size_t *c, size_t v)
+{
+	/*
+	 * sleep until the other end moves on from v (or we’re told to
+	 * quit); it only takes the lock to wake us if it can see that
+	 * someone is waiting
+	 */
+	pthread_mutex_lock(&s->mutex);
+	__atomic_add_fetch(&s->waiting, 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(c, __ATOMIC_SEQ_CST) == v && !__atomic_load_n(&s->quit, __ATOMIC_SEQ_CST))
+		pthread_cond_wait(&s->cond, &s->mutex);
+	__atomic_sub_fetch(&s->waiting, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&s->mutex);
+	return;
+}
+
+static void stage_wake(stage_t *s)
+{
+	if (!__atomic_load_n(&s->waiting, __ATOMIC_SEQ_CST))
+		return;
+	pthread_mutex_lock(&s->mutex);
+	pthread_cond_broadcast(&s->cond);
+	pthread_mutex_unlock(&s->mutex);
+	return;
+}
+
+static ssize_t stage_write(stage_t *s, const void *d, size_t l)
+{
+	for (size_t r = 0; r < l; )
+	{
+		int e = __atomic_load_n(&s->error, __ATOMIC_SEQ_CST);
+		if (e)
+			return errno = e , -1;
+		size_t t;
+		if (s->head - (t = __atomic_load_n(&s->tail, __ATOMIC_SEQ_CST)) >= s->blocks)
+		{
+			stage_wait(s, &s->tail, t);
+			continue;
+		}
+		stage_block_t *b = &s->block[s->head % s->blocks];
+		size_t z = s->size - b->length;
+		if (z > l - r)
+			z = l - r;
+		memcpy(b->data + b->length, d + r, z);
+		b->length += z;
+		r += z;
+		if (b->length == s->size)
+		{
+			__atomic_store_n(&s->head, s->head + 1, __ATOMIC_SEQ_CST);
+			stage_wake(s);
+		}
+	}
+	return l;
+}
+
+static ssize_t stage_read(stage_t *s, void *d, size_t l)
+{
+	size_t r = 0;
+	while (r < l)
+	{
+		size_t h;
+		if ((h = __atomic_load_n(&s->head, __ATOMIC_SEQ_CST)) == s->tail)
+		{
+			if (__atomic_load_n(&s->quit, __ATOMIC_SEQ_CST))
+				return errno = ECANCELED , -1;
+			stage_wait(s, &s->head, h);
+			continue;
+		}
+		stage_block_t *b = &s->block[s->tail % s->blocks];
+		size_t z = b->length - b->offset;
+		if (z > l - r)
+			z = l - r;
+		memcpy(d + r, b->data + b->offset, z);
+		b->offset += z;
+		r += z;
+		if (b->offset < b->length)
+			break;
+		if (b->error)
+			return errno = b->error , -1;
+		/*
+		 * hang on to the last block so that every read after it
+		 * also finds the end of the file
+		 */
+		if (b->eof)
+			break;
+		b->length = 0;
+		__atomic_store_n(&s->tail, s->tail + 1, __ATOMIC_SEQ_CST);
+		stage_wake(s);
+	}
+	return r;
+}
+
+static int stage_flush(stage_t *s, bool y)
+{
+	/*
+	 * hand over whatever there is, even if that’s nothing, and wait
+	 * for the stage to catch up
+	 */
+	if (s->reading)
+		return 0;
+	size_t t;
+	while (s->head - (t = __atomic_load_n(&s->tail, __ATOMIC_SEQ_CST)) >= s->blocks)
+		stage_wait(s, &s->tail, t);
+	s->block[s->head % s->blocks].sync = y;
+	size_t h = s->head + 1;
+	__atomic_store_n(&s->head, h, __ATOMIC_SEQ_CST);
+	stage_wake(s);
+	while ((t = __atomic_load_n(&s->tail, __ATOMIC_SEQ_CST)) != h)
+		stage_wait(s, &s->tail, t);
+	int e = __atomic_load_n(&s->error, __ATOMIC_SEQ_CST);
+	return e ? errno = e , -1 : 0;
+}
+
+static void stage_quit(stage_t *s)
+{
+	__atomic_store_n(&s->quit, true, __ATOMIC_SEQ_CST);
+	pthread_mutex_lock(&s->mutex);
+	pthread_cond_broadcast(&s->cond);
+	pthread_mutex_unlock(&s->mutex);
+	return;
+}
+
+static size_t stage_end(stage_t *s)
+{
+	/*
+	 * returns how much had been read ahead but not yet used
+	 */
+	pthread_join(s->thread, NULL);
+	size_t z = 0;
+	for (size_t i = s->tail; i != s->head; i++)
+		z += s->block[i % s->blocks].length - s->block[i % s->blocks].offset;
+	for (size_t i = 0; i < s->blocks; i++)
+	{
+		/*
+		 * blocks can hold plaintext too
+		 */
+		memset(s->block[i].data, 0x00, s->size);
+		free(s->block[i].data);
+	}
+	free(s->block);
+	pthread_cond_destroy(&s->cond);
+	pthread_mutex_destroy(&s->mutex);
+	free(s);
+	return z;
+}
+
+#ifdef HAVE_LIBURING
+/*
+ * only worthwhile for regular files (and never those opened to append,
+ * as the writes are at explicit offsets); when reading the file needs
+ * to be larger than a single buffer too
+ */
+static uring_t *uring_init(io_private_t *f, bool r)
+{
+	struct stat s;
+	if (fstat(f->fd, &s) < 0 || !S_ISREG(s.st_mode))
+		return NULL;
+	int flags = fcntl(f->fd, F_GETFL);
+	if (flags < 0 || flags & O_APPEND)
+		return NULL;
+	off_t p = lseek(f->fd, 0, SEEK_CUR);
+	if (p < 0 || (r && s.st_size - p <= (off_t)io_buffer_size))
+		return NULL;
+	uring_t *u = calloc(1, sizeof( uring_t ));
+	if (!u)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, sizeof( uring_t ));
+	if (io_uring_queue_init(IO_URING_DEPTH, &u->ring, 0) < 0)
+	{
+		/*
+		 * not supported (or not allowed); carry on as before
+		 */
+		free(u);
+		return NULL;
+	}
+	u->size = io_buffer_size;
+	for (size_t i = 0; i < IO_URING_DEPTH; i++)
+		u->data[i] = buf_alloc(u->size);
+	u->position = p;
+	u->reading = r;
+	f->uring = u;
+	if (r)
+	{
+		/*
+		 * ask for the first few buffers all at once
+		 */
+		for (size_t i = 0; i < IO_URING_DEPTH; i++)
+			uring_queue(f, i);
+		uring_submit(u);
+	}
+	return u;
+}
+
+static void uring_queue(io_private_t *f, size_t i)
+{
+	uring_t *u = f->uring;
+	struct io_uring_sqe *e = io_uring_get_sqe(&u->ring);
+	if (!e)
+	{
+		if (!u->error)
+			u->error = EBUSY;
+		return;
+	}
+	u->at[i] = u->position;
+	if (u->reading)
+	{
+		io_uring_prep_read(e, f->fd, u->data[i], u->size, u->at[i]);
+		u->position += u->size;
+	}
+	else
+	{
+		io_uring_prep_write(e, f->fd, u->data[i], u->length[i], u->at[i]);
+		u->position += u->length[i];
+	}
+	io_uring_sqe_set_data(e, (void *)(uintptr_t)i);
+	u->busy[i] = true;
+	return;
+}
+
+static void uring_submit(uring_t *u)
+{
+	int e;
+	while ((e = io_uring_submit(&u->ring)) == -EINTR)
+		;
+	if (e < 0)
+	{
+		/*
+		 * there’s no telling what the kernel has; stop here and
+		 * leave it be (see uring_end)
+		 */
+		u->error = -e;
+		u->lost = true;
+	}
+	return;
+}
+
+/*
+ * wait for the next request to complete; anything less than the whole
+ * buffer is finished off synchronously, so that a short read always
+ * means the end of the file
+ */
+static void uring_reap(io_private_t *f)
+{
+	uring_t *u = f->uring;
+	if (u->lost)
+		return;
+	struct io_uring_cqe *c = NULL;
+	int e;
+	while ((e = io_uring_wait_cqe(&u->ring, &c)) == -EINTR)
+		;
+	if (e < 0)
+	{
+		u->error = -e;
+		u->lost = true;
+		return;
+	}
+	size_t i = (uintptr_t)io_uring_cqe_get_data(c);
+	ssize_t x = c->res;
+	io_uring_cqe_seen(&u->ring, c);
+	u->busy[i] = false;
+	bool y = x == -EINVAL && direct_off(f); /* do it all again, without O_DIRECT */
+	if (x < 0 && !y)
+	{
+		if (!u->error)
+			u->error = -x;
+		return;
+	}
+	size_t l = u->reading ? u->size : u->length[i];
+	size_t t = y ? 0 : x;
+	while ((x || y) && t < l)
+	{
+		y = false;
+		if ((x = u->reading ? pread(f->fd, u->data[i] + t, l - t, u->at[i] + t) : pwrite(f->fd, u->data[i] + t, l - t, u->at[i] + t)) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (!u->error)
+				u->error = errno;
+			return;
+		}
+		t += x;
+	}
+	if (!u->reading && t < l && !u->error)
+		u->error = EIO;
+	u->length[i] = u->reading ? t : 0;
+	if (io_drop_cache)
+		cache_advise(f, u->at[i] + t, !u->reading);
+	return;
+}
+
+static ssize_t uring_write(io_private_t *f, const void *d, size_t l)
+{
+	uring_t *u = f->uring;
+	for (size_t r = 0; r < l; )
+	{
+		if (u->error)
+			return errno = u->error , -1;
+		size_t i = u->current;
+		if (u->busy[i])
+		{
+			uring_reap(f);
+			continue;
+		}
+		size_t z = u->size - u->length[i];
+		if (z > l - r)
+			z = l - r;
+		memcpy(u->data[i] + u->length[i], d + r, z);
+		u->length[i] += z;
+		r += z;
+		if (u->length[i] == u->size)
+		{
+			uring_queue(f, i);
+			uring_submit(u);
+			u->current = (i + 1) % IO_URING_DEPTH;
+		}
+	}
+	return l;
+}
+
+static ssize_t uring_read(io_private_t *f, void *d, size_t l)
+{
+	uring_t *u = f->uring;
+	size_t r = 0;
+	while (r < l)
+	{
+		if (u->error)
+			return r ? (ssize_t)r : (errno = u->error , -1);
+		size_t i = u->current;
+		if (u->busy[i])
+		{
+			uring_reap(f);
+			continue;
+		}
+		size_t z = u->length[i] - u->offset;
+		if (z > l - r)
+			z = l - r;
+		memcpy(d + r, u->data[i] + u->offset, z);
+		u->offset += z;
+		r += z;
+		if (u->offset < u->length[i] || u->length[i] < u->size)
+			break; /* either done, or at the end of the file */
+		/*
+		 * this buffer is used up; have it read what comes after the
+		 * last one
+		 */
+		u->offset = 0;
+		uring_queue(f, i);
+		uring_submit(u);
+		u->current = (i + 1) % IO_URING_DEPTH;
+	}
+	return r;
+}
+
+static int uring_flush(io_private_t *f)
+{
+	uring_t *u = f->uring;
+	if (u->reading)
+		return 0;
+	if (u->length[u->current] && !u->busy[u->current] && !u->error)
+	{
+		uring_queue(f, u->current);
+		uring_submit(u);
+		u->current = (u->current + 1) % IO_URING_DEPTH;
+	}
+	for (size_t i = 0; i < IO_URING_DEPTH && !u->lost; i++)
+		while (u->busy[i] && !u->lost)
+			uring_reap(f);
+	return u->error ? (errno = u->error , -1) : 0;
+}
+
+/*
+ * wait for everything still in flight, then leave the file offset where
+ * the caller thinks it is, as though this had never been used
+ */
+static void uring_end(io_private_t *f)
+{
+	uring_t *u = f->uring;
+	for (size_t i = 0; i < IO_URING_DEPTH; i++)
+		while (u->busy[i] && !u->lost)
+			uring_reap(f);
+	f->uring = NULL;
+	if (u->lost)
+		return; /* the kernel could still be using the buffers */
+	off_t p = u->reading ? u->at[u->current] + (off_t)u->offset : u->position;
+	io_uring_queue_exit(&u->ring);
+	for (size_t i = 0; i < IO_URING_DEPTH; i++)
+	{
+		/*
+		 * as with the staging buffer, these can hold plaintext
+		 */
+		memset(u->data[i], 0x00, u->size);
+		free(u->data[i]);
+	}
+	free(u);
+	lseek(f->fd, p, SEEK_SET);
+	return;
+}
+
+/*
+ * take the file descriptor if the file was opened ahead of time; any
+ * opened before it, but never asked for, are closed
+ */
+static int64_t uring_opened(int d, const char *n, int f)
+{
+	int64_t fd = -1;
+	pthread_mutex_lock(&uring_opens_mutex);
+	size_t m = uring_open_tail;
+	for (; m != uring_open_head; m++)
+		if (uring_open[m % IO_URING_OPENS].dir == d && uring_open[m % IO_URING_OPENS].flags == f && !strcmp(uring_open[m % IO_URING_OPENS].path, n))
+			break;
+	if (m != uring_open_head)
+		for (bool y = false; !y; uring_open_tail++)
+		{
+			uring_open_t *o = &uring_open[uring_open_tail % IO_URING_OPENS];
+			while (o->busy)
+				uring_open_reap();
+			if ((y = uring_open_tail == m))
+				fd = o->fd;
+			else if (o->fd >= 0)
+				close(o->fd);
+			free(o->path);
+			o->path = NULL;
+		}
+	pthread_mutex_unlock(&uring_opens_mutex);
+	return fd;
+}
+
+static void uring_open_reap(void)
+{
+	struct io_uring_cqe *c = NULL;
+	int e;
+	while ((e = io_uring_wait_cqe(&uring_opens, &c)) == -EINTR)
+		;
+	if (e < 0)
+	{
+		/*
+		 * give up on them all; they’ll be opened as usual instead
+		 */
+		uring_opens_failed = true;
+		for (size_t i = 0; i < IO_URING_OPENS; i++)
+			uring_open[i].busy = false , uring_open[i].fd = -1;
+		return;
+	}
+	uring_open_t *o = io_uring_cqe_get_data(c);
+	o->fd = c->res;
+	o->busy = false;
+	io_uring_cqe_seen(&uring_opens, c);
+	return;
+}
+#endif
+
+static void io_compress_buffer_init(io_private_t *io_ptr, size_t l)
+{
+	if (io_ptr->buffer_compress)
+		return;
+	if (!(io_ptr->buffer_compress = malloc(sizeof( buffer_t ))))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, sizeof( buffer_t ));
+	io_ptr->buffer_compress->block = io_buffer_size > l ? io_buffer_size : l;
+	if (!(io_ptr->buffer_compress->stream = malloc(io_ptr->buffer_compress->block)))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, io_ptr->buffer_compress->block);
+	for (unsigned i = 0; i < OFFSET_SLOTS; i++)
+		io_ptr->buffer_compress->offset[i] = 0;
+	return;
+}
+
+static void io_do_compress(io_private_t *io_ptr)
+{
+	uint32_t threads = compress_threads ? : lzma_cputhreads();
+	io_ptr->compress_encoder = true;
+	switch (io_ptr->compressor)
+	{
+#ifdef HAVE_ZSTD
+		case IO_COMPRESSOR_ZSTD:
+			io_compress_buffer_init(io_ptr, ZSTD_CStreamOutSize());
+			if (!(io_ptr->zstd_cctx = ZSTD_createCCtx()))
+				return;
+			if (compress_level >= 0)
+				ZSTD_CCtx_setParameter(io_ptr->zstd_cctx, ZSTD_c_compressionLevel, compress_level);
+			if (threads > 1)
+			{
+				/*
+				 * silently ignored if libzstd was built without
+				 * threads
+				 */
+				ZSTD_CCtx_setParameter(io_ptr->zstd_cctx, ZSTD_c_nbWorkers, threads);
+				if (compress_block_size)
+					ZSTD_CCtx_setParameter(io_ptr->zstd_cctx, ZSTD_c_jobSize, compress_block_size);
+			}
+			io_ptr->compress_init = true;
+			return;
+#endif
+#ifdef HAVE_LZ4
+		case IO_COMPRESSOR_LZ4:
+		{
+			io_compress_buffer_init(io_ptr, LZ4F_compressBound(LZ4_CHUNK, NULL));
+			if (LZ4F_isError(LZ4F_createCompressionContext(&io_ptr->lz4_cctx, LZ4F_VERSION)))
+				return;
+			LZ4F_preferences_t p;
+			memset(&p, 0x00, sizeof p);
+			p.compressionLevel = compress_level < 0 ? 0 : compress_level;
+			size_t r = LZ4F_compressBegin(io_ptr->lz4_cctx, io_ptr->buffer_compress->stream, io_ptr->buffer_compress->block, &p);
+			if (LZ4F_isError(r))
+				return;
+			io_ptr->buffer_compress->offset[0] = r;
+			io_ptr->compress_init = true;
+			return;
+		}
+#endif
+		default:
+			break;
+	}
+
+	lzma_stream l = LZMA_STREAM_INIT;
+	io_ptr->lzma_handle = l;
+	io_compress_buffer_init(io_ptr, 0);
+	io_ptr->lzma_handle.next_out = io_ptr->buffer_compress->stream;
+	io_ptr->lzma_handle.avail_out = io_ptr->buffer_compress->block;
+
+	lzma_filter lzf[2];
+	lzma_options_lzma lzo;
+	if (compress_level < 0 || lzma_lzma_preset(&lzo, compress_level))
+		lzma_lzma_preset(&lzo, LZMA_PRESET_DEFAULT);
+	lzf[0].id = LZMA_FILTER_LZMA2;
+	lzf[0].options = &lzo;
+	lzf[1].id = LZMA_VLI_UNKNOWN;
+	if (threads > 1)
+	{
+		/*
+		 * the threaded encoder splits the data into blocks, each
+		 * compressed independently; the decoder doesn’t mind
+		 */
+		lzma_mt mt = { .flags = 0,
+				.threads = threads,
+				.block_size = compress_block_size,
+				.timeout = 0,
+				.filters = lzf,
+				.check = LZMA_CHECK_NONE };
+		if (lzma_stream_encoder_mt(&io_ptr->lzma_handle, &mt) != LZMA_OK)
+			return;
+	}
+	else if (lzma_stream_encoder(&io_ptr->lzma_handle, lzf, LZMA_CHECK_NONE) != LZMA_OK)
+		return;
+	io_ptr->compress_init = true;
+	return;
+}
+
+static void io_do_decompress(io_private_t *io_ptr)
+{
+	io_ptr->compress_encoder = false;
+	switch (io_ptr->compressor)
+	{
+#ifdef HAVE_ZSTD
+		case IO_COMPRESSOR_ZSTD:
+			io_compress_buffer_init(io_ptr, ZSTD_DStreamInSize());
+			if (!(io_ptr->zstd_dctx = ZSTD_createDCtx()))
+				return;
+			io_ptr->compress_init = true;
+			return;
+#endif
+#ifdef HAVE_LZ4
+		case IO_COMPRESSOR_LZ4:
+			io_compress_buffer_init(io_ptr, 0);
+			if (LZ4F_isError(LZ4F_createDecompressionContext(&io_ptr->lz4_dctx, LZ4F_VERSION)))
+				return;
+			io_ptr->compress_init = true;
+			return;
+#endif
+		default:
+			break;
+	}
+
+	lzma_stream l = LZMA_STREAM_INIT;
+	io_ptr->lzma_handle = l;
+	io_compress_buffer_init(io_ptr, 0);
+	/*
+	 * start with anything left over from before compression was
+	 * suspended
+	 */
+	buffer_t *b = io_ptr->buffer_compress;
+	io_ptr->lzma_handle.next_in = b->stream + b->offset[2];
+	io_ptr->lzma_handle.avail_in = b->offset[1] - b->offset[2];
+	b->offset[1] = b->offset[2] = 0;
+
+#if LZMA_VERSION >= UINT32_C(50040002)
+	uint32_t threads = lzma_decoder_threads ? : lzma_cputhreads();
+	if (threads > 1)
+	{
+		/*
+		 * only streams with multiple blocks (which record their
+		 * sizes) can be decoded in parallel; anything else is
+		 * decoded by a single thread, as before
+		 */
+		lzma_mt mt = { .flags = 0/*LZMA_CONCATENATED*/,
+				.threads = threads,
+				.timeout = 0,
+				.memlimit_threading = lzma_memlimit,
+				.memlimit_stop = UINT64_MAX };
+		if (lzma_stream_decoder_mt(&io_ptr->lzma_handle, &mt) != LZMA_OK)
+			return;
+	}
+	else
+#endif
 	if (lzma_stream_decoder(&io_ptr->lzma_handle, UINT64_MAX, 0/*LZMA_CONCATENATED*/) != LZMA_OK)
 		return;
 
-	io_ptr->lzma_init = true;
+	io_ptr->compress_init = true;
 	return;
 }
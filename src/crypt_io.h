@@ -38,6 +38,45 @@
 #define IO_STDOUT_FILENO io_use_stdout() /*!< Macro wrapper for io_use_stdout() */
 #define IO_UNINITIALISED io_dummy_handle() /*!< Macro wrapper for io_dummy_handle() */
 
+#define IO_BUFFER_DEFAULT 0x100000 /*!< Default size of the staging buffer at the bottom of the IO stack (1MiB) */
+#define IO_BUFFER_MINIMUM 0x1000   /*!< Smallest staging buffer allowed (4KiB) */
+#define IO_THREADS_DEFAULT 1       /*!< Default number of threads for (de)compression and encryption */
+#define IO_COMPRESS_LEVEL_DEFAULT -1 /*!< Use the compression algorithm’s own default level */
+#define IO_OPEN_AHEAD 4            /*!< Number of files worth opening ahead of time; see io_open_ahead() */
+
+/*!
+ * \brief  Compression algorithms
+ *
+ * Which algorithm compressed the data. Stored as a single byte in the
+ * encrypted data (but only when it isn’t xz, which was the only option
+ * in all previous versions).
+ */
+typedef enum
+{
+	IO_COMPRESSOR_XZ,     /*!< xz (LZMA2); always available */
+	IO_COMPRESSOR_ZSTD,   /*!< Zstandard; if built with libzstd */
+	IO_COMPRESSOR_LZ4,    /*!< LZ4 (frame format); if built with liblz4 */
+	IO_COMPRESSOR_UNKNOWN /*!< Unknown, or not available in this build */
+} __attribute__((packed))
+io_compressor_e;
+
+/*!
+ * \brief  Error correction profiles
+ *
+ * How (and whether) the data is protected by error correction. Since
+ * 2026.11 this is stored as a single byte in the header; before that
+ * every version since 2015.10 used the compatible profile.
+ */
+typedef enum
+{
+	IO_CORRECTION_OFF,         /*!< No error correction */
+	IO_CORRECTION_RS,          /*!< Reed-Solomon (255,249); only the last codeword has a length, and it’s cut short */
+	IO_CORRECTION_INTERLEAVED, /*!< As above, with each batch of codewords interleaved, so a burst of errors is spread over them all */
+	IO_CORRECTION_COMPAT,      /*!< Reed-Solomon (255,249), every codeword after its length (2015.10 – 2026.10; never stored) */
+	IO_CORRECTION_UNKNOWN      /*!< Unknown profile */
+} __attribute__((packed))
+io_correction_e;
+
 typedef void * IO_HANDLE; /*<! Handle type for IO functions */
 
 #if defined _WIN32 && !defined _MODE_T_
@@ -72,9 +111,26 @@ typedef struct
 {
 	x_iv_e x_iv;    /*!< Whether to use the older (less correct) IV generation */
 	bool x_encrypt; /*!< Encrypt (or decrypt) */
+	bool x_chunked; /*!< Split into independently authenticated chunks (ignored if the MAC can only be used once) */
 }
 io_extra_t;
 
+/*!
+ * \brief  What was found when scrubbing a region of a file
+ *
+ * The error correction of a file can be checked (and repaired) without
+ * the key, a region at a time; see io_scrub().
+ */
+typedef struct
+{
+	off_t offset;       /*!< Where in the file the region begins */
+	size_t length;      /*!< Size of the region in the file */
+	uint32_t codewords; /*!< Number of codewords in the region */
+	uint32_t corrected; /*!< Codewords (or their lengths) which had errors that were corrected */
+	uint32_t failed;    /*!< Codewords which couldn’t be corrected */
+}
+io_scrub_t;
+
 /*!
  * \brief         Open a file
  * \param[in]  n  The file name
@@ -87,6 +143,19 @@ io_extra_t;
  */
 extern IO_HANDLE io_open(const char *n, int f, mode_t m) __attribute__((malloc, nonnull(1)));
 
+/*!
+ * \brief         Open a file within a directory
+ * \param[in]  d  An open directory, or AT_FDCWD
+ * \param[in]  n  The file name, relative to the directory
+ * \param[in]  f  File open flags
+ * \param[in]  m  File open mode
+ * \return        A new IO instance for the specified file
+ *
+ * As io_open(), but the file is found relative to the directory d (as
+ * with openat()), so its path isn’t looked up from the beginning again.
+ */
+extern IO_HANDLE io_open_at(int d, const char *n, int f, mode_t m) __attribute__((malloc, nonnull(2)));
+
 /*!
  * \brief         Destroy an IO instance
  * \param[in]  h  An IO instance to destroy
@@ -138,6 +207,238 @@ extern IO_HANDLE io_use_stdin(void);
  */
 extern IO_HANDLE io_use_stdout(void);
 
+/*!
+ * \brief         Set the size of the IO staging buffer
+ * \param[in]  l  The size of the buffer in bytes
+ *
+ * All data is staged in a buffer before it’s written to the underlying
+ * file, so that it reaches the disk in a few large writes instead of
+ * one per cipher block or ECC codeword. The buffer is only flushed
+ * when full, or by io_sync(), io_seek() and io_close(). Reading works
+ * the same way in reverse: the buffer is filled a chunk at a time and
+ * the data is handed out from memory. Applies to all IO instances which
+ * have not yet read or written anything.
+ */
+extern void io_set_buffer_size(size_t l);
+
+/*!
+ * \brief         Get the size of the IO staging buffer
+ * \return        The size of the buffer in bytes
+ *
+ * The size of the staging buffer is also the ideal amount of data to
+ * read or write at a time; reads and writes of (at least) this size
+ * bypass the buffer and are encrypted/decrypted in bulk.
+ */
+extern size_t io_get_buffer_size(void);
+
+/*!
+ * \brief         Enable pipeline mode
+ * \param[in]  p  Whether to run the lower layers on their own threads
+ *
+ * In pipeline mode error correction, and the reading and writing of the
+ * file itself, each happen on their own thread, joined to the layer above
+ * by a ring of buffers; the data is no different. Applies to all IO
+ * instances which have not yet been read from or written to.
+ */
+extern void io_set_pipeline(bool p);
+
+/*!
+ * \brief         Use io_uring for reading and writing files
+ * \param[in]  u  Whether to use io_uring
+ *
+ * Reads and writes of regular files are handed to the kernel several
+ * buffers (of the staging buffer size) at a time, so the disk is kept
+ * busy while the data is being processed; this takes the place of the
+ * pipeline’s IO thread. Only available when built with liburing, and
+ * should the kernel not support it the usual reads and writes are used
+ * instead. Applies to all IO instances which have not yet been read
+ * from or written to.
+ */
+extern void io_set_uring(bool u);
+
+/*!
+ * \brief         Keep files out of the page cache
+ * \param[in]  d  Whether to drop data from the page cache once done with
+ * \param[in]  o  Whether to open files with O_DIRECT (implies d)
+ *
+ * For very large jobs: input is dropped from the page cache as soon as
+ * it has been read (with the next part asked for in advance) and output
+ * is written back, then dropped, a window at a time, rather than
+ * leaving it all to pile up. With O_DIRECT the page cache is bypassed
+ * altogether (if the file system allows); anything not suitably aligned,
+ * such as the end of a file, is read/written as usual. Applies to files
+ * opened with io_open() from now on.
+ */
+extern void io_set_cache(bool d, bool o);
+
+/*!
+ * \brief         Read regular files through a memory mapping
+ * \param[in]  m  Whether to map files which are only read
+ *
+ * Files opened read only are mapped in their entirety and read straight
+ * from the mapping, rather than being copied into the staging buffer
+ * first; what has been read is released from the mapping as reading
+ * moves on. Applies to all IO instances which have not yet been read
+ * from. NB: should the file be truncated while it’s being read, the
+ * process will be sent SIGBUS.
+ */
+extern void io_set_mmap(bool m);
+
+/*!
+ * \brief         Borrow data straight from the mapped file
+ * \param[in]  f  An IO instance
+ * \param[out] d  Where the data starts
+ * \param[in]  l  The length of data wanted
+ * \return        The length of data available (0 at end of file), or -1
+ *                if the data can’t be borrowed, in which case use
+ *                io_read() instead
+ *
+ * Avoids copying the data at all, but is only possible when the file is
+ * mapped (see io_set_mmap()) and nothing is done to the data as it is
+ * read. The data is valid until the next call to io_map() or io_read().
+ */
+extern ssize_t io_map(IO_HANDLE f, const void **d, size_t l) __attribute__((nonnull(1, 2)));
+
+/*!
+ * \brief         Open a file ahead of time
+ * \param[in]  d  The directory the file is in, or AT_FDCWD
+ * \param[in]  n  The file name
+ * \param[in]  f  File open flags
+ * \param[in]  m  File open mode
+ *
+ * A hint that the file is about to be opened with io_open_at() (with the
+ * same directory, name and flags); with io_uring the open happens in the background
+ * and io_open() only collects the result. Any files opened ahead of one
+ * which is then asked for, but which never were themselves, are closed.
+ * Does nothing unless io_uring is being used.
+ */
+extern void io_open_ahead(int d, const char *n, int f, mode_t m) __attribute__((nonnull(2)));
+
+/*!
+ * \brief         Forget any files opened ahead of time
+ *
+ * Close all files opened by io_open_ahead() which were never asked for.
+ */
+extern void io_open_ahead_end(void);
+
+/*!
+ * \brief         Set the number of threads used for encryption
+ * \param[in]  t  Number of threads; 0 for one per CPU core
+ *
+ * Data which is split into chunks (since 2026.10) can have each chunk
+ * encrypted/decrypted and authenticated by a pool of threads; they are
+ * still written/read in order. Applies to all IO instances which have
+ * not yet been initialised for encryption. The same number of threads
+ * encode/decode batches of error correction codewords.
+ */
+extern void io_set_encryption_threads(uint32_t t);
+
+/*!
+ * \brief         Set the number of threads used for compression
+ * \param[in]  t  Number of threads; 0 for one per CPU core
+ * \param[in]  b  Size (in bytes) of each xz block; 0 lets liblzma decide
+ *
+ * With more than one thread the input is split into blocks of the given
+ * size which are compressed in parallel. The result is still a single xz
+ * stream, so decompresses exactly as before, albeit a little larger.
+ * Applies to all IO instances which have not yet written anything.
+ */
+extern void io_set_compression_threads(uint32_t t, uint64_t b);
+
+/*!
+ * \brief         Get a list of the available compression algorithms
+ * \return        A NULL terminated array of names
+ *
+ * The list depends on which libraries were available at build time; xz
+ * will always be present.
+ */
+extern const char **io_list_of_compressors(void);
+
+/*!
+ * \brief         Check whether a compression algorithm is available
+ * \param[in]  a  The compression algorithm
+ * \return        Whether this build supports it
+ */
+extern bool io_compressor_available(io_compressor_e a);
+
+/*!
+ * \brief         Get the compression algorithm from its name
+ * \param[in]  n  The name of the algorithm (xz, zstd or lz4)
+ * \return        The algorithm, or IO_COMPRESSOR_UNKNOWN if it is not
+ *                known or not available
+ */
+extern io_compressor_e io_compressor_from_name(const char * const restrict n) __attribute__((nonnull(1)));
+
+/*!
+ * \brief         Set the algorithm used to compress new data
+ * \param[in]  a  The compression algorithm
+ * \param[in]  l  The compression level; IO_COMPRESS_LEVEL_DEFAULT for
+ *                the algorithm’s own default
+ *
+ * Set the compression algorithm (and level) used when encrypting. The
+ * thread settings above also apply to zstd; LZ4 is always single
+ * threaded.
+ */
+extern void io_set_compressor(io_compressor_e a, int l);
+
+/*!
+ * \brief         Get the algorithm used to compress new data
+ * \return        The compression algorithm
+ */
+extern io_compressor_e io_get_compressor(void);
+
+/*!
+ * \brief         Compress a whole buffer in one go
+ * \param[in]  a  The compression algorithm
+ * \param[in]  d  The data to compress
+ * \param[in]  l  Length of the data
+ * \param[out] b  The compressed data; free() it when done
+ * \return        Length of the compressed data, or -1 on error
+ *
+ * Compress data as a single, complete stream; it can be written
+ * (while compression is suspended) in place of writing the data itself
+ * between io_compression_resume() and io_compression_suspend(). Needs
+ * no IO instance, so it can be called from any number of threads. The
+ * compression level is as set by io_set_compressor().
+ */
+extern ssize_t io_compress_all(io_compressor_e a, const void *d, size_t l, uint8_t **b) __attribute__((nonnull(2, 4)));
+
+/*!
+ * \brief         Get the error correction profile from its name
+ * \param[in]  n  The name of the profile (off, rs or interleaved)
+ * \return        The profile, or IO_CORRECTION_UNKNOWN if it is not
+ *                known
+ */
+extern io_correction_e io_correction_from_name(const char * const restrict n) __attribute__((nonnull(1)));
+
+/*!
+ * \brief         Set the error correction profile used for new data
+ * \param[in]  c  The error correction profile
+ *
+ * Only applies to the current container version; older versions have
+ * the compatible profile (or none at all).
+ */
+extern void io_set_correction(io_correction_e c);
+
+/*!
+ * \brief         Get the error correction profile used for new data
+ * \return        The error correction profile
+ */
+extern io_correction_e io_get_correction(void);
+
+/*!
+ * \brief         Set the number of threads used for decompression
+ * \param[in]  t  Number of threads; 0 for one per CPU core
+ * \param[in]  m  Memory limit (in bytes) for threaded decoding; 0 for none
+ *
+ * Streams which were compressed in blocks (see above) can have those
+ * blocks decompressed in parallel. Should doing so need more than the
+ * given amount of memory, fewer threads are used (down to just the one);
+ * decoding never fails because of the limit. Applies to all IO instances
+ * which have not yet read anything.
+ */
+extern void io_set_decompression_threads(uint32_t t, uint64_t m);
+
 /*!
  * \brief         Check if IO instance is initialised
  * \param[in]  h  An IO instance
@@ -190,6 +491,57 @@ extern ssize_t io_write(IO_HANDLE f, const void *d, size_t l) __attribute__((non
  */
 extern ssize_t io_read(IO_HANDLE f, void *d, size_t l) __attribute__((nonnull(1, 2)));
 
+/*!
+ * \brief         Where in the decrypted data the next read/write is
+ * \param[in]  f  An IO instance
+ * \return        The offset, or -1 on error
+ *
+ * Offsets within the decrypted (or yet to be encrypted) data are only
+ * known when it is in chunks (see io_encryption_chunked()); errno is
+ * ENOTSUP otherwise. They count from the start of the encrypted data,
+ * and include anything that was compressed as it is after compression.
+ */
+extern int64_t io_tell_plain(IO_HANDLE f) __attribute__((nonnull(1)));
+
+/*!
+ * \brief         How much decrypted data there is in total
+ * \param[in]  f  An IO instance
+ * \return        The size, or -1 on error
+ *
+ * Includes whatever the final chunk was padded with; only available
+ * when decrypting chunks.
+ */
+extern int64_t io_size_plain(IO_HANDLE f) __attribute__((nonnull(1)));
+
+/*!
+ * \brief         Read decrypted data from anywhere in the file
+ * \param[in]  f  An IO instance
+ * \param[out] d  The data read
+ * \param[in]  l  The length of data to read (size of d)
+ * \param[in]  o  Where to read from (see io_tell_plain())
+ * \return        The number of bytes read (short at the end of the data),
+ *                or -1 on error
+ *
+ * Only the chunks which cover the range are read, authenticated and
+ * decrypted; nothing is decompressed. errno is ENOTSUP without chunks,
+ * and EBADMSG if a chunk fails authentication. Where io_read() is up to
+ * doesn’t change.
+ */
+extern ssize_t io_pread_plain(IO_HANDLE f, void *d, size_t l, uint64_t o) __attribute__((nonnull(1, 2)));
+
+/*!
+ * \brief         Continue reading from elsewhere in the decrypted data
+ * \param[in]  f  An IO instance
+ * \param[in]  o  Where to continue from (see io_tell_plain())
+ * \return        0 on success, -1 on error
+ *
+ * From now on io_read() reads chunks from where they are, starting with
+ * the one which holds the given offset. Anything read ahead is thrown
+ * away, and decompression (if compression has not been suspended) will
+ * start afresh, so o must be where a compressed stream begins.
+ */
+extern int io_seek_plain(IO_HANDLE f, uint64_t o) __attribute__((nonnull(1)));
+
 /*!
  * \brief         Sync data waiting to be written
  * \param[in]  f  An IO instance
@@ -230,11 +582,32 @@ extern void io_encryption_init(IO_HANDLE f, enum gcry_cipher_algos c, enum gcry_
 /*!
  * \brief         Compression initialisation
  * \param[in]  f  An IO instance
+ * \param[in]  a  The compression algorithm
  *
  * Turn on compression/decompression for the rest of the life of this
  * handle.
  */
-extern void io_compression_init(IO_HANDLE f) __attribute__((nonnull(1)));
+extern void io_compression_init(IO_HANDLE f, io_compressor_e a) __attribute__((nonnull(1)));
+
+/*!
+ * \brief         Suspend compression
+ * \param[in]  f  An IO instance
+ *
+ * End the current compressed stream; data is then written/read as-is
+ * (but still encrypted) until compression is resumed. When reading,
+ * anything the decompressor read beyond the end of its stream is kept
+ * and used first.
+ */
+extern void io_compression_suspend(IO_HANDLE f) __attribute__((nonnull(1)));
+
+/*!
+ * \brief         Resume compression
+ * \param[in]  f  An IO instance
+ *
+ * Start a new compressed stream, using the same algorithm as before,
+ * after compression was suspended.
+ */
+extern void io_compression_resume(IO_HANDLE f) __attribute__((nonnull(1)));
 
 /*!
  * \brief         Read/Write data checksum initialisation
@@ -266,12 +639,41 @@ extern void io_encryption_checksum(IO_HANDLE f, uint8_t **b, size_t *l) __attrib
  */
 extern void io_encryption_mac(IO_HANDLE f, uint8_t **b, size_t *l) __attribute__((nonnull(1)));
 
+/*!
+ * \brief         Whether the data is split into authenticated chunks
+ * \param[in]  f  An IO instance
+ * \return        Whether each chunk has its own MAC
+ *
+ * Chunks were asked for when initialising encryption, but can only be
+ * used with a MAC; when they are, neither the checksum nor the MAC of
+ * all the data is needed.
+ */
+extern bool io_encryption_chunked(IO_HANDLE f) __attribute__((nonnull(1)));
+
 /*!
  * \brief         Enable ECC
  * \param[in]  f  An IO instance
+ * \param[in]  c  The error correction profile (not IO_CORRECTION_OFF)
  *
  * Enable error correction in IO. Uses Reed-Solomon error correction.
  */
-extern void io_correction_init(IO_HANDLE f) __attribute__((nonnull(1)));
+extern void io_correction_init(IO_HANDLE f, io_correction_e c) __attribute__((nonnull(1)));
+
+/*!
+ * \brief         Check, and correct, the next region of ECC
+ * \param[in]  f  An IO instance, with ECC enabled
+ * \param[in]  o  Where the repaired file is written (or NULL)
+ * \param[out] r  What was found in the region
+ * \return        1 for each region, 0 once there are none left, -1 on error
+ *
+ * Verify each codeword of the region that follows (a fixed number of
+ * them, checked by several threads at once if so configured) without
+ * decoding any further, so no key is needed. Those with errors are
+ * corrected, and their parity recalculated. The region is written to o,
+ * whether anything was corrected or not; without o, regions which were
+ * corrected are written back in place, so f needs to be open for both
+ * reading and writing.
+ */
+extern int io_scrub(IO_HANDLE f, IO_HANDLE o, io_scrub_t *r) __attribute__((nonnull(1, 3)));
 
 #endif /* ! _ENCRYPT_CRYPTIO_H_ */
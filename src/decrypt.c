@@ -36,6 +36,9 @@
 	#include <netinet/in.h>
 #endif
 
+#include <pthread.h>
+#include <lzma.h>
+
 #include "common/common.h"
 #include "common/non-gnu.h"
 #include "common/error.h"
@@ -56,8 +59,61 @@ static bool read_metadata(crypto_t *);
 static void skip_random_data(crypto_t *);
 
 static void decrypt_directory(crypto_t *, const char *);
+static void decrypt_index(crypto_t *);
 static void decrypt_stream(crypto_t *);
 static void decrypt_file(crypto_t *);
+static void decrypt_range(crypto_t *);
+
+/*
+ * a directory which has been made, kept open until everything in it has
+ * been too
+ */
+typedef struct
+{
+	char *path; /* as it was encrypted (relative to the top) */
+	int fd;
+}
+made_t;
+
+static made_t *made_remember(made_t *, size_t, char *, int);
+static void made_forget(made_t *);
+
+#define BEHIND_JOBS 0x40 /*!< Most files (within a directory) waiting to be written at once */
+
+/*
+ * a file within a directory, decrypted but not yet written; a worker
+ * creates it, writes it and closes it
+ */
+typedef struct
+{
+	int dir;     /* the directory it’s in (a copy, so it outlives the original) */
+	char *path;  /* within it */
+	uint8_t *data;
+	uint64_t size;
+}
+behind_job_t;
+
+typedef struct
+{
+	pthread_t *threads;
+	uint32_t count;
+	pthread_mutex_t mutex;
+	pthread_cond_t queued; /* workers wait for something to write */
+	pthread_cond_t done;   /* and the decrypting thread for room */
+	behind_job_t job[BEHIND_JOBS];
+	uint64_t head;         /* next to be written */
+	uint64_t tail;         /* next free */
+	uint64_t busy;         /* being written */
+	uint64_t used;         /* how much is being held, of c->write_behind */
+	bool quit;
+}
+behind_t;
+
+static void behind_init(crypto_t *);
+static void *behind_worker(void *);
+static void behind_file(crypto_t *, int, const char *);
+static void behind_wait(crypto_t *);
+static void behind_end(crypto_t *);
 
 extern crypto_t *decrypt_init(const char * const restrict i,
                               const char * const restrict o,
@@ -87,6 +143,7 @@ extern crypto_t *decrypt_init(const char * const restrict i,
 		z->source = IO_STDIN_FILENO;
 
 	z->path = NULL;
+	z->compressor = IO_COMPRESSOR_XZ;
 	z->compressed = false;
 	z->directory = false;
 
@@ -220,9 +277,10 @@ static void *process(void *ptr)
 	/*
 	 * the 2011.* versions (incorrectly) used key length instead of block
 	 * length; and up until 2017.XX a kdf was not used; from 2020.01 the
-	 * kdf iterations can be user defined
+	 * kdf iterations can be user defined; from 2026.10 the data is in
+	 * authenticated chunks (except raw data, which has no version)
 	 */
-	io_extra_t iox = { iv_type, false };
+	io_extra_t iox = { iv_type, false, c->version >= VERSION_2026_10 && !c->raw };
 	io_encryption_init(c->source, c->cipher, c->hash, c->mode, c->mac, c->kdf_iterations, c->key, c->length, iox);
 	c->status = STATUS_RUNNING;
 	gcry_free(c->key);
@@ -244,11 +302,20 @@ static void *process(void *ptr)
 	if (!skip_some_random && !c->raw)
 		skip_random_data(c);
 
+	/*
+	 * part of a file can only be found if it’s in chunks, and wasn’t
+	 * compressed
+	 */
+	if (c->range && (c->directory || c->compressed || c->blocksize || !io_encryption_chunked(c->source)))
+		return c->status = STATUS_FAILED_RANGE , (void *)c->status;
+	if ((c->list || c->extract) && !c->indexed)
+		return c->status = STATUS_FAILED_INDEX , (void *)c->status;
+
 	/*
 	 * main decryption loop
 	 */
 	if (c->compressed)
-		io_compression_init(c->source);
+		io_compression_init(c->source, c->compressor);
 
 	/*
 	 * The ever-expanding decrypt function!
@@ -266,13 +333,21 @@ static void *process(void *ptr)
 	 */
 	io_encryption_checksum_init(c->source, c->hash);
 
-	if (c->directory)
+	if (c->list || c->extract)
+		decrypt_index(c);
+	else if (c->directory)
+	{
+		if (c->write_behind)
+			behind_init(c);
 		decrypt_directory(c, c->path);
+		if (c->behind)
+			behind_end(c);
+	}
 	else
 	{
 		c->current.size = c->total.size;
 		c->total.size = 1;
-		c->blocksize ? decrypt_stream(c) : decrypt_file(c);
+		c->range ? decrypt_range(c) : c->blocksize ? decrypt_stream(c) : decrypt_file(c);
 	}
 
 	if (c->status != STATUS_RUNNING)
@@ -281,7 +356,7 @@ static void *process(void *ptr)
 	c->current.offset = c->current.size;
 	c->total.offset = c->total.size;
 
-	if (c->version != VERSION_2011_08 && !c->raw)
+	if (c->version != VERSION_2011_08 && !io_encryption_chunked(c->source) && !c->raw)
 	{
 		/*
 		 * verify checksum (on versions which calculated it correctly)
@@ -297,10 +372,29 @@ static void *process(void *ptr)
 		gcry_free(b);
 	}
 
-	if (!c->raw)
+	if (!c->raw && !c->range && !c->list && !c->extract)
 		skip_random_data(c);
 
-	if (c->kdf_iterations && c->version >= VERSION_2020_01)
+	if (c->indexed && !c->list && !c->extract)
+	{
+		/*
+		 * the table of contents isn’t needed, but reading through it
+		 * means the final chunk is authenticated
+		 */
+		io_compression_suspend(c->source);
+		size_t t = io_get_buffer_size();
+		uint8_t *b = malloc(t);
+		if (!b)
+			die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, t);
+		int64_t r;
+		while ((r = io_read(c->source, b, t)) > 0)
+			;
+		if (r < 0)
+			c->status = errno == EBADMSG ? STATUS_FAILED_MAC : STATUS_FAILED_IO;
+		free(b);
+	}
+
+	if (c->kdf_iterations && c->version >= VERSION_2020_01 && !io_encryption_chunked(c->source))
 	{
 		uint8_t *mac = NULL;
 		size_t mac_length = 0;
@@ -336,8 +430,8 @@ static uint64_t read_version(crypto_t *c)
 		return 0;
 
 	version_e v = check_version(ntohll(head[2]));
-	if (v >= VERSION_2015_10 && !c->raw)
-		io_correction_init(c->source);
+	if (!c->raw && (c->correction = correction_init(c->source, v)) == IO_CORRECTION_UNKNOWN)
+		return 0;
 
 	uint8_t l;
 	io_read(c->source, &l, sizeof l);
@@ -388,9 +482,12 @@ static bool read_verification_sum(crypto_t *c)
 	uint64_t x = 0;
 	uint64_t y = 0;
 	uint64_t z = 0;
-	io_read(c->source, &x, sizeof x);
-	io_read(c->source, &y, sizeof y);
-	io_read(c->source, &z, sizeof z);
+	/*
+	 * since 2026.10 a wrong password fails authentication of the first
+	 * chunk, so the read itself can fail
+	 */
+	if (io_read(c->source, &x, sizeof x) < 0 || io_read(c->source, &y, sizeof y) < 0 || io_read(c->source, &z, sizeof z) < 0)
+		return c->status = STATUS_FAILED_DECRYPTION, false;
 	x = ntohll(x);
 	y = ntohll(y);
 	z = ntohll(z);
@@ -436,8 +533,15 @@ static bool read_metadata(crypto_t *c)
 		c->blocksize = 0;
 
 	c->compressed = tlv_has_tag(tlv, TAG_COMPRESSED) ? tlv_value_of(tlv, TAG_COMPRESSED)[0] : false;
+	c->compressor = tlv_has_tag(tlv, TAG_COMPRESSOR) ? tlv_value_of(tlv, TAG_COMPRESSOR)[0] : IO_COMPRESSOR_XZ;
+	if (c->compressed && !io_compressor_available(c->compressor))
+		c->status = STATUS_FAILED_UNKNOWN_TAG;
 	c->directory = tlv_has_tag(tlv, TAG_DIRECTORY) ? tlv_value_of(tlv, TAG_DIRECTORY)[0] : false;
-	if (c->directory)
+	c->indexed = tlv_has_tag(tlv, TAG_INDEX) ? tlv_value_of(tlv, TAG_INDEX)[0] : false;
+	c->shared = tlv_has_tag(tlv, TAG_INDEX) && tlv_value_of(tlv, TAG_INDEX)[0] == INDEX_SHARED;
+	if (c->list || c->extract)
+		; /* the output isn’t known until the table of contents has been read */
+	else if (c->directory)
 	{
 		struct stat s;
 		stat(c->path, &s);
@@ -499,26 +603,64 @@ static void skip_random_data(crypto_t *c)
 static void decrypt_directory(crypto_t *c, const char *dir)
 {
 	bool lnerr = false;
+	/*
+	 * directories come before what’s in them (depth first) so the
+	 * parent of each is either the last one made or one of its
+	 * parents; keep track of those (and keep them open) so that
+	 * everything is made from the directory it’s in, rather than from
+	 * the top each time
+	 */
+	made_t *made = malloc(sizeof( made_t ));
+	size_t depth = 0;
+	if (!made || !(made[depth].path = strdup("")))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, sizeof( made_t ));
+	made[depth++].fd = openat(AT_FDCWD, dir, O_RDONLY | O_DIRECTORY);
+	/*
+	 * small files may share a compressed stream; keep track of how
+	 * much has gone in it, to know where they started another
+	 */
+	uint64_t span = 0;
+	bool segmented = false;
 	for (c->total.offset = 0; c->total.offset < c->total.size && c->status == STATUS_RUNNING; c->total.offset++)
 	{
-		file_type_e tp;
-		io_read(c->source, &tp, sizeof( byte_t ));
-
+		file_type_e tp = FILE_DIRECTORY;
 		uint64_t l;
-		io_read(c->source, &l, sizeof l);
+		if (io_read(c->source, &tp, sizeof( byte_t )) < 0 || io_read(c->source, &l, sizeof l) < 0)
+		{
+			c->status = errno == EBADMSG ? STATUS_FAILED_MAC : STATUS_FAILED_IO;
+			break;
+		}
 		l = ntohll(l);
 		char *filename = NULL;
 		if (!(filename = gcry_calloc_secure(l + sizeof( byte_t ), sizeof( char ))))
 			die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, l + sizeof( byte_t ));
 		io_read(c->source, filename, l);
-		char *fullpath = NULL;
-		if (!asprintf(&fullpath, "%s/%s", dir, filename))
-			die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, strlen(dir) + l + 2 * sizeof( byte_t ));
-		gcry_free(filename);
+		span += sizeof( byte_t ) + sizeof l + l;
+		/*
+		 * find the directory it’s in (the top, made already, is never
+		 * forgotten); should it not have been made (which never
+		 * happens, unless the entries are out of order) make it now
+		 */
+		char *name = strrchr(filename, '/');
+		size_t z = name ? (size_t)(name - filename) : 0;
+		name = name ? name + 1 : filename;
+		for (; depth > 1 && (strlen(made[depth - 1].path) != z || strncmp(made[depth - 1].path, filename, z)); depth--)
+			made_forget(&made[depth - 1]);
+		if (z && depth == 1)
+		{
+			char *x = NULL;
+			if (asprintf(&x, "%s/%.*s", dir, (int)z, filename) < 0)
+				die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, strlen(dir) + z + 2);
+			recursive_mkdir(x, S_IRUSR | S_IWUSR | S_IXUSR);
+			made = made_remember(made, depth++, strndup(filename, z), openat(AT_FDCWD, x, O_RDONLY | O_DIRECTORY));
+			free(x);
+		}
+		int at = made[depth - 1].fd;
 		switch (tp)
 		{
 			case FILE_DIRECTORY:
-				recursive_mkdir(fullpath, S_IRUSR | S_IWUSR | S_IXUSR);
+				mkdirat(at, name, S_IRUSR | S_IWUSR | S_IXUSR);
+				made = made_remember(made, depth++, strdup(filename), at < 0 ? -1 : openat(at, name, O_RDONLY | O_DIRECTORY));
 				break;
 			case FILE_SYMLINK:
 			case FILE_LINK:
@@ -528,44 +670,288 @@ static void decrypt_directory(crypto_t *c, const char *dir)
 				if (!lnk)
 					die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, l + sizeof( byte_t ));
 				io_read(c->source, lnk, l);
+				span += sizeof l + l;
 				if (tp == FILE_SYMLINK)
 				{
 #ifndef _WIN32
-					symlink(lnk, fullpath);
+					symlinkat(lnk, at, name);
 #else
 					lnerr = true;
 #endif
 				}
 				else
 				{
-					char *hl = NULL;
-					if (!asprintf(&hl, "%s/%s", dir, lnk))
-						die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, strlen(dir) + strlen(lnk) + 2);
-					/* NB: on Windows this is just a copy not a link */
-					link(hl, fullpath);
-					free(hl);
+					/*
+					 * NB: what it links to is relative to the top,
+					 * and must have been written
+					 */
+					if (c->behind)
+						behind_wait(c);
+					linkat(made[0].fd, lnk, at, name, 0);
 				}
+				gcry_free(lnk);
 				break;
 			case FILE_REGULAR:
+			case FILE_STORED:
 				c->current.offset = 0;
 				io_read(c->source, &c->current.size, sizeof c->current.size);
 				c->current.size = ntohll(c->current.size);
+				span += sizeof c->current.size;
+				/*
+				 * (files too big to be held are written as
+				 * they’re decrypted, as usual)
+				 */
+				bool behind = c->behind && c->current.size <= c->write_behind;
+				if (c->output)
+					io_close(c->output);
+				c->output = behind ? NULL : io_open_at(at, name, O_CREAT | O_TRUNC | O_WRONLY | F_WRLCK | O_BINARY, S_IRUSR | S_IWUSR);
+				/*
+				 * stored files weren’t compressed, even if
+				 * everything around them was; with a table of
+				 * contents every file was compressed on its own,
+				 * unless it’s small enough to share a stream
+				 */
+				bool shared = c->shared && tp == FILE_REGULAR && c->current.size < INDEX_SHARED_MAXIMUM;
+				if (shared && (!segmented || span >= INDEX_SHARED_SPAN))
+				{
+					io_compression_suspend(c->source);
+					io_compression_resume(c->source);
+					segmented = true;
+					span = 0;
+				}
+				if (!shared && (tp == FILE_STORED || c->indexed))
+					io_compression_suspend(c->source);
+				if (!shared && tp == FILE_REGULAR)
+					io_compression_resume(c->source);
+				behind ? behind_file(c, at, name) : decrypt_file(c);
+				if (shared)
+					span += c->current.size;
+				else if (c->indexed)
+				{
+					io_compression_suspend(c->source);
+					segmented = true;
+					span = 0;
+				}
+				if (!shared && (tp == FILE_STORED || c->indexed))
+					io_compression_resume(c->source);
 				if (c->output)
 					io_close(c->output);
-				c->output = io_open(fullpath, O_CREAT | O_TRUNC | O_WRONLY | F_WRLCK | O_BINARY, S_IRUSR | S_IWUSR);
-				decrypt_file(c);
-				io_close(c->output);
 				c->output = NULL;
 				c->current.offset = c->total.size;
 				break;
 		}
-		gcry_free(fullpath);
+		gcry_free(filename);
 	}
+	while (depth)
+		made_forget(&made[--depth]);
+	free(made);
 	if (lnerr)
 		c->status = STATUS_WARNING_LINK;
 	return;
 }
 
+/*
+ * add a directory to those made (and still open), returning where
+ * they’re all kept now
+ */
+static made_t *made_remember(made_t *made, size_t depth, char *path, int fd)
+{
+	made_t *x = realloc(made, (depth + 1) * sizeof( made_t ));
+	if (!x || !path)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, (depth + 1) * sizeof( made_t ));
+	x[depth].path = path;
+	x[depth].fd = fd;
+	return x;
+}
+
+static void made_forget(made_t *m)
+{
+	if (m->fd >= 0)
+		close(m->fd);
+	free(m->path);
+	return;
+}
+
+/*
+ * the table of contents lists every entry, and where the data of each
+ * file is, so just one can be decrypted; where the table itself starts
+ * is at the very end
+ */
+static void decrypt_index(crypto_t *c)
+{
+	uint64_t o = 0;
+	int64_t s = io_size_plain(c->source);
+	errno = EXIT_SUCCESS;
+	if (s < (int64_t)sizeof o || io_pread_plain(c->source, &o, sizeof o, s - sizeof o) != sizeof o || io_seek_plain(c->source, ntohll(o)) < 0)
+	{
+		c->status = errno == EBADMSG ? STATUS_FAILED_MAC : STATUS_FAILED_INDEX;
+		return;
+	}
+	o = ntohll(o);
+	/*
+	 * when small files share streams, so too is the table compressed
+	 */
+	if (!c->shared)
+		io_compression_suspend(c->source);
+	if (io_read(c->source, &c->total.size, sizeof c->total.size) != sizeof c->total.size)
+	{
+		c->status = errno == EBADMSG ? STATUS_FAILED_MAC : STATUS_FAILED_INDEX;
+		return;
+	}
+	c->total.size = ntohll(c->total.size);
+
+	if (c->list && !io_is_initialised(c->output))
+	{
+		io_release(c->output);
+		if (!(c->output = io_open(c->path, O_CREAT | O_TRUNC | O_WRONLY | F_WRLCK | O_BINARY, S_IRUSR | S_IWUSR)))
+			c->status = STATUS_FAILED_IO;
+	}
+
+	bool found = false;
+	int hl = 0;
+	char *lnk = NULL;
+	file_type_e tp = FILE_DIRECTORY;
+	uint64_t v[4] = { 0 }; /* size, offset, length, skip (if shared) */
+	size_t n = c->shared ? 4 : 3;
+	for (c->total.offset = 0; c->total.offset < c->total.size && c->status == STATUS_RUNNING && !found; c->total.offset++)
+	{
+		uint64_t l[2];
+		char *e[2] = { NULL, NULL }; /* path, link */
+		if (io_read(c->source, &tp, sizeof( byte_t )) != sizeof( byte_t ))
+			break;
+		for (int i = 0; i < 2; i++)
+		{
+			io_read(c->source, &l[i], sizeof l[i]);
+			l[i] = ntohll(l[i]);
+			if (!(e[i] = calloc(l[i] + sizeof( byte_t ), sizeof( char ))))
+				die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, l[i] + sizeof( byte_t ));
+			io_read(c->source, e[i], l[i]);
+		}
+		if (io_read(c->source, v, n * sizeof v[0]) != (ssize_t)(n * sizeof v[0]))
+			c->status = errno == EBADMSG ? STATUS_FAILED_MAC : STATUS_FAILED_INDEX;
+		for (size_t i = 0; i < n; i++)
+			v[i] = ntohll(v[i]);
+		if (c->status != STATUS_RUNNING)
+			;
+		else if (c->list)
+		{
+			static const char TYPE[] = { 'd', '-', 'l', 'h', '-' };
+			char *x = NULL;
+			int z = asprintf(&x, "%c %12" PRIu64 " %s%s%s\n", tp < sizeof TYPE ? TYPE[tp] : '?', v[0], e[0], l[1] ? " -> " : "", e[1]);
+			if (z > 0)
+				io_write(c->output, x, z);
+			free(x);
+		}
+		else if (strcmp(e[0], c->extract))
+			;
+		else if (tp == FILE_REGULAR || tp == FILE_STORED)
+			found = true;
+		else if (tp == FILE_SYMLINK)
+		{
+			found = true;
+			lnk = e[1];
+			e[1] = NULL;
+		}
+		else if (tp == FILE_DIRECTORY)
+			c->status = STATUS_FAILED_NOT_A_FILE;
+		else if (tp == FILE_LINK && !hl++)
+		{
+			/*
+			 * a hard link has no data of its own; look again for
+			 * what it links to (which comes before it)
+			 */
+			free(c->extract);
+			c->extract = e[1];
+			e[1] = NULL;
+			c->total.offset = UINT64_MAX;
+			uint64_t z;
+			if (io_seek_plain(c->source, o) < 0 || io_read(c->source, &z, sizeof z) != sizeof z)
+				c->status = errno == EBADMSG ? STATUS_FAILED_MAC : STATUS_FAILED_INDEX;
+		}
+		free(e[0]);
+		free(e[1]);
+	}
+	if (c->list || c->status != STATUS_RUNNING)
+		return;
+	if (!found)
+	{
+		c->status = STATUS_FAILED_NOT_FOUND;
+		return;
+	}
+
+	/*
+	 * decrypt (and decompress) just the one file
+	 */
+	if (!io_is_initialised(c->output))
+	{
+		struct stat s;
+		if (!stat(c->path, &s) && S_ISDIR(s.st_mode))
+		{
+			char *n = dir_get_name(c->extract);
+			char *ptr = NULL;
+			asprintf(&ptr, "%s/%s", c->path, n);
+			free(n);
+			free(c->path);
+			c->path = ptr;
+		}
+		io_release(c->output);
+		c->output = NULL;
+		if (tp == FILE_SYMLINK)
+		{
+			/*
+			 * a symlink has no data; it’s made again as it was
+			 */
+#ifndef _WIN32
+			unlink(c->path);
+			if (symlink(lnk, c->path) < 0)
+				c->status = STATUS_FAILED_IO;
+#else
+			c->status = STATUS_WARNING_LINK;
+#endif
+			free(lnk);
+			return;
+		}
+		if (!(c->output = io_open(c->path, O_CREAT | O_TRUNC | O_WRONLY | F_WRLCK | O_BINARY, S_IRUSR | S_IWUSR)))
+		{
+			c->status = STATUS_FAILED_IO;
+			return;
+		}
+	}
+	else if (tp == FILE_SYMLINK)
+	{
+		free(lnk);
+		c->status = STATUS_FAILED_OUTPUT_MISMATCH;
+		return;
+	}
+	if (io_seek_plain(c->source, v[1]) < 0)
+	{
+		c->status = STATUS_FAILED_INDEX;
+		return;
+	}
+	if (tp == FILE_REGULAR)
+		io_compression_resume(c->source);
+	else
+		io_compression_suspend(c->source);
+	/*
+	 * a small file may not be at the start of its stream
+	 */
+	for (uint8_t x[BLOCK_SIZE]; v[3] && c->status == STATUS_RUNNING; )
+	{
+		ssize_t z = io_read(c->source, x, v[3] < sizeof x ? v[3] : sizeof x);
+		if (z <= 0)
+			c->status = errno == EBADMSG ? STATUS_FAILED_MAC : STATUS_FAILED_INDEX;
+		else
+			v[3] -= z;
+	}
+	if (c->status != STATUS_RUNNING)
+		return;
+	c->total.size = 1;
+	c->total.offset = 0;
+	c->current.size = v[0];
+	decrypt_file(c);
+	return;
+}
+
 static void decrypt_stream(crypto_t *c)
 {
 	bool b = true;
@@ -578,7 +964,7 @@ static void decrypt_stream(crypto_t *c)
 		int64_t r = io_read(c->source, buffer, c->blocksize + sizeof b);
 		if (r < 0)
 		{
-			c->status = r < -1 ? STATUS_FAILED_LZMA : STATUS_FAILED_IO;
+			c->status = r < -1 ? STATUS_FAILED_LZMA : errno == EBADMSG ? STATUS_FAILED_MAC : STATUS_FAILED_IO;
 			break;
 		}
 		memcpy(&b, buffer, sizeof b);
@@ -598,20 +984,207 @@ static void decrypt_stream(crypto_t *c)
 
 static void decrypt_file(crypto_t *c)
 {
-	uint8_t buffer[BLOCK_SIZE];
-	for (c->current.offset = 0; c->current.offset < c->current.size && c->status == STATUS_RUNNING; c->current.offset += BLOCK_SIZE)
+	/*
+	 * move as much as the IO layer can handle in one go (but don’t
+	 * bother with a huge buffer for a small file)
+	 */
+	size_t t = io_get_buffer_size();
+	if (t > c->current.size)
+		t = c->current.size ? : sizeof( byte_t );
+	uint8_t *buffer = malloc(t);
+	if (!buffer)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, t);
+	for (c->current.offset = 0; c->current.offset < c->current.size && c->status == STATUS_RUNNING; c->current.offset += t)
 	{
 		errno = EXIT_SUCCESS;
-		size_t l = BLOCK_SIZE;
-		if (c->current.offset + BLOCK_SIZE > c->current.size)
-			l = BLOCK_SIZE - (c->current.offset + BLOCK_SIZE - c->current.size);
+		size_t l = t;
+		if (c->current.offset + t > c->current.size)
+			l = t - (c->current.offset + t - c->current.size);
 		int64_t r = io_read(c->source, buffer, l);
 		if (r < 0)
 		{
-			c->status = r < -1 ? STATUS_FAILED_LZMA : STATUS_FAILED_IO;
+			c->status = r < -1 ? STATUS_FAILED_LZMA : errno == EBADMSG ? STATUS_FAILED_MAC : STATUS_FAILED_IO;
 			break;
 		}
 		io_write(c->output, buffer, r);
 	}
+	memset(buffer, 0x00, t);
+	free(buffer);
+	return;
+}
+
+static void decrypt_range(crypto_t *c)
+{
+	/*
+	 * only the chunks which cover the range are read; anything beyond
+	 * the end of the file (as given by its metadata) is left out
+	 */
+	uint64_t o = c->range_offset < c->current.size ? c->range_offset : c->current.size;
+	c->current.size -= o;
+	o += io_tell_plain(c->source);
+	if (c->range_length && c->range_length < c->current.size)
+		c->current.size = c->range_length;
+	size_t t = io_get_buffer_size();
+	if (t > c->current.size)
+		t = c->current.size ? : sizeof( byte_t );
+	uint8_t *buffer = malloc(t);
+	if (!buffer)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, t);
+	c->current.offset = 0;
+	while (c->current.offset < c->current.size && c->status == STATUS_RUNNING)
+	{
+		errno = EXIT_SUCCESS;
+		size_t l = t;
+		if (c->current.offset + t > c->current.size)
+			l = c->current.size - c->current.offset;
+		int64_t r = io_pread_plain(c->source, buffer, l, o + c->current.offset);
+		if (r <= 0)
+		{
+			c->status = r < 0 && errno == EBADMSG ? STATUS_FAILED_MAC : STATUS_FAILED_IO;
+			break;
+		}
+		io_write(c->output, buffer, r);
+		c->current.offset += r;
+	}
+	memset(buffer, 0x00, t);
+	free(buffer);
+	return;
+}
+
+static void behind_init(crypto_t *c)
+{
+	behind_t *b = calloc(1, sizeof( behind_t ));
+	if (!b)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, sizeof( behind_t ));
+	b->count = c->workers ? : lzma_cputhreads() ? : 1;
+	if (!(b->threads = calloc(b->count, sizeof( pthread_t ))))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, b->count * sizeof( pthread_t ));
+	pthread_mutex_init(&b->mutex, NULL);
+	pthread_cond_init(&b->queued, NULL);
+	pthread_cond_init(&b->done, NULL);
+	c->behind = b;
+	for (uint32_t i = 0; i < b->count; i++)
+		pthread_create(&b->threads[i], NULL, behind_worker, b);
+	return;
+}
+
+static void *behind_worker(void *ptr)
+{
+	behind_t *b = ptr;
+	pthread_mutex_lock(&b->mutex);
+	while (true)
+	{
+		while (!b->quit && b->head == b->tail)
+			pthread_cond_wait(&b->queued, &b->mutex);
+		if (b->head == b->tail)
+			break; /* only once there’s nothing left */
+		behind_job_t j = b->job[b->head++ % BEHIND_JOBS];
+		b->busy++;
+		pthread_mutex_unlock(&b->mutex);
+
+		IO_HANDLE f = j.dir < 0 ? NULL : io_open_at(j.dir, j.path, O_CREAT | O_TRUNC | O_WRONLY | F_WRLCK | O_BINARY, S_IRUSR | S_IWUSR);
+		if (f)
+		{
+			if (j.size)
+				io_write(f, j.data, j.size);
+			io_close(f);
+		}
+		if (j.data)
+		{
+			memset(j.data, 0x00, j.size);
+			free(j.data);
+		}
+		free(j.path);
+		if (j.dir >= 0)
+			close(j.dir);
+
+		pthread_mutex_lock(&b->mutex);
+		b->used -= j.size;
+		b->busy--;
+		pthread_cond_broadcast(&b->done);
+	}
+	pthread_mutex_unlock(&b->mutex);
+	return NULL;
+}
+
+static void behind_file(crypto_t *c, int dir, const char *path)
+{
+	/*
+	 * wait for room (which the workers always make) then decrypt the
+	 * whole file and leave it to them
+	 */
+	behind_t *b = c->behind;
+	behind_job_t j = { dir < 0 ? -1 : dup(dir), strdup(path), NULL, c->current.size };
+	if (!j.path)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, strlen(path));
+	pthread_mutex_lock(&b->mutex);
+	while (b->tail - b->head == BEHIND_JOBS || b->used + j.size > c->write_behind)
+		pthread_cond_wait(&b->done, &b->mutex);
+	b->used += j.size;
+	pthread_mutex_unlock(&b->mutex);
+
+	if (j.size && !(j.data = malloc(j.size)))
+		die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, j.size);
+	size_t t = io_get_buffer_size();
+	for (c->current.offset = 0; c->current.offset < c->current.size && c->status == STATUS_RUNNING; )
+	{
+		errno = EXIT_SUCCESS;
+		if (c->current.offset + t > c->current.size)
+			t = c->current.size - c->current.offset;
+		int64_t r = io_read(c->source, j.data + c->current.offset, t);
+		if (r < 0)
+		{
+			c->status = r < -1 ? STATUS_FAILED_LZMA : errno == EBADMSG ? STATUS_FAILED_MAC : STATUS_FAILED_IO;
+			break;
+		}
+		c->current.offset += r;
+		if ((size_t)r < t)
+			break;
+	}
+
+	pthread_mutex_lock(&b->mutex);
+	if (c->current.offset < j.size)
+	{
+		/*
+		 * only as much as was decrypted (the data may have ended
+		 * early) is written
+		 */
+		b->used -= j.size - c->current.offset;
+		j.size = c->current.offset;
+	}
+	b->job[b->tail++ % BEHIND_JOBS] = j;
+	pthread_cond_signal(&b->queued);
+	pthread_mutex_unlock(&b->mutex);
+	return;
+}
+
+static void behind_wait(crypto_t *c)
+{
+	behind_t *b = c->behind;
+	pthread_mutex_lock(&b->mutex);
+	while (b->head != b->tail || b->busy)
+		pthread_cond_wait(&b->done, &b->mutex);
+	pthread_mutex_unlock(&b->mutex);
+	return;
+}
+
+static void behind_end(crypto_t *c)
+{
+	/*
+	 * everything decrypted so far is still written
+	 */
+	behind_t *b = c->behind;
+	pthread_mutex_lock(&b->mutex);
+	b->quit = true;
+	pthread_cond_broadcast(&b->queued);
+	pthread_mutex_unlock(&b->mutex);
+	for (uint32_t i = 0; i < b->count; i++)
+		pthread_join(b->threads[i], NULL);
+	pthread_mutex_destroy(&b->mutex);
+	pthread_cond_destroy(&b->queued);
+	pthread_cond_destroy(&b->done);
+	free(b->threads);
+	free(b);
+	c->behind = NULL;
 	return;
 }
@@ -37,7 +37,9 @@
 	#include <netinet/in.h>
 #endif
 
+#include <pthread.h>
 #include <gcrypt.h>
+#include <lzma.h>
 
 #include "common/common.h"
 #include "common/non-gnu.h"
@@ -57,20 +59,147 @@ static inline void write_verification_sum(crypto_t *);
 static inline void write_metadata(crypto_t *);
 static inline void write_random_data(crypto_t *);
 
-static int64_t count_entries(crypto_t *, const char *);
+/*
+ * everything within a directory, found by walking it just the once:
+ * what each entry is, its size, where it lives (for finding hard links)
+ * and its path, which is kept along with all the others in one block
+ */
+typedef struct
+{
+	uint64_t size;    /* of a file (0 for anything else) */
+	size_t path;      /* where its path starts in the arena */
+	size_t name;      /* and where its name (the end of its path) does */
+	uint32_t depth;   /* how many directories down it is (0 for those at the top) */
+	dev_t dev;
+	ino_t inode;
+	file_type_e type; /* directory, regular file or symlink */
+	bool linked;      /* has other (hard) links */
+}
+manifest_entry_t;
+
+/*
+ * the first entry found for each file which has more than one (hard)
+ * link, in an open addressing hash table keyed on its device and inode
+ */
+typedef struct
+{
+	dev_t dev;
+	ino_t inode;
+	uint64_t entry;   /* its index in the manifest, plus 1 (0 is unused) */
+}
+manifest_link_t;
+
+typedef struct
+{
+	int at;           /* the directory the walk starts from */
+	uint32_t depth;   /* deepest any entry is */
+	manifest_entry_t *entry;
+	uint64_t count;
+	uint64_t capacity;
+	char *arena;      /* every path, one after the other, each with a trailing \0 */
+	size_t length;
+	size_t size;
+	manifest_link_t *link;
+	uint64_t links;   /* entries which have other links */
+	uint64_t mask;    /* size of the link table, less 1 */
+}
+manifest_t;
+
+#define MANIFEST_ENTRIES 0x100  /*!< Number of entries the manifest has room for to begin with (it doubles each time it fills) */
+#define MANIFEST_ARENA   0x4000 /*!< Initial size of the block all the paths are kept in */
 
-static void encrypt_directory(crypto_t *, const char *);
-static char *encrypt_link(crypto_t *, char *, struct stat);
+static manifest_t *manifest_init(int, const char *);
+static int manifest_open(int, const char *);
+static void manifest_walk(crypto_t *, manifest_t *, int, const char *, size_t, uint32_t);
+static size_t manifest_add(manifest_t *, size_t, uint32_t, const char *, const struct stat *, file_type_e);
+static void manifest_links(manifest_t *);
+static void manifest_free(manifest_t *);
+
+static void encrypt_directory(crypto_t *);
+static void encrypt_index(crypto_t *, file_type_e, const char *, const char *, uint64_t, uint64_t, uint64_t, uint64_t);
+static void encrypt_index_end(crypto_t *);
+static const char *encrypt_link(crypto_t *, uint64_t);
+static bool encrypt_stored(crypto_t *, int, const char *, uint64_t);
 static void encrypt_stream(crypto_t *);
 static void encrypt_file(crypto_t *);
 
+#define AHEAD_JOBS 0x40 /*!< Most files (within a directory) read ahead of time at once */
+
+/*
+ * a file within a directory, opened, read (and perhaps compressed) by
+ * a worker before it’s needed
+ */
+typedef struct
+{
+	const char *path; /* in the manifest */
+	IO_HANDLE source;
+	uint8_t *data;   /* the start of the file, all of it if possible */
+	uint64_t size;   /* size of the file */
+	uint64_t length; /* how much of it has been read (or its length once compressed) */
+	bool stored:1;
+	bool packed:1;   /* data is the whole file, compressed */
+	bool done:1;
+}
+ahead_job_t;
+
 typedef struct
 {
-	dev_t dev;
-	ino_t inode;
-	char *path;
+	pthread_t *threads;
+	uint32_t count;
+	pthread_mutex_t mutex;
+	pthread_cond_t queued; /* workers wait for something to read */
+	pthread_cond_t done;   /* and the emitter for it to be read */
+	ahead_job_t job[AHEAD_JOBS];
+	uint64_t head;         /* next to be written (in manifest order) */
+	uint64_t next;         /* next to be read */
+	uint64_t tail;         /* next free */
+	uint64_t used;         /* how much is being held, of c->look_ahead */
+	bool quit;
+}
+ahead_t;
+
+static void ahead_init(crypto_t *);
+static void *ahead_worker(void *);
+static bool ahead_queue(crypto_t *, const char *, uint64_t);
+static bool ahead_take(crypto_t *, const char *, ahead_job_t *);
+static void ahead_release(crypto_t *, ahead_job_t *);
+static void ahead_end(crypto_t *);
+
+#define STORED_MINIMUM 0x10000 /*!< Files smaller than this are always compressed */
+#define STORED_SAMPLE  0x1000  /*!< Size of each sample used to decide whether a file is worth compressing */
+
+typedef struct
+{
+	size_t offset;
+	size_t length;
+	const char *magic;
 }
-link_count_t;
+stored_magic_t;
+
+/*
+ * file formats which are already compressed (or encrypted)
+ */
+static const stored_magic_t STORED_MAGIC[] =
+{
+	{ 0, 2, "\x1F\x8B" },                         /* gzip */
+	{ 0, 3, "BZh" },                              /* bzip2 */
+	{ 0, 6, "\xFD" "7zXZ\x00" },                  /* xz */
+	{ 0, 4, "\x28\xB5\x2F\xFD" },                 /* zstd */
+	{ 0, 4, "\x04\x22\x4D\x18" },                 /* lz4 */
+	{ 0, 4, "PK\x03\x04" },                       /* zip (and everything based on it) */
+	{ 0, 6, "7z\xBC\xAF\x27\x1C" },               /* 7-zip */
+	{ 0, 4, "Rar!" },                             /* rar */
+	{ 0, 3, "\xFF\xD8\xFF" },                     /* jpeg */
+	{ 0, 8, "\x89PNG\r\n\x1A\n" },                /* png */
+	{ 0, 4, "GIF8" },                             /* gif */
+	{ 8, 4, "WEBP" },                             /* webp */
+	{ 4, 4, "ftyp" },                             /* mp4, mov, heic, etc */
+	{ 0, 4, "\x1A\x45\xDF\xA3" },                 /* matroska, webm */
+	{ 0, 4, "OggS" },                             /* ogg */
+	{ 0, 4, "fLaC" },                             /* flac */
+	{ 0, 3, "ID3" },                              /* mp3 */
+	{ 0, 8, "\x36\x97\xDE\x5D\x96\xFC\xA0\xFA" }  /* encrypt */
+};
 
 extern crypto_t *encrypt_init(const char * const restrict i,
                               const char * const restrict o,
@@ -234,6 +363,8 @@ extern crypto_t *encrypt_init(const char * const restrict i,
 			z->kdf_iterations = KEY_ITERATIONS_201709;
 			break;
 		case VERSION_2020_01:
+		case VERSION_2026_10:
+		case VERSION_2026_11:
 			z->kdf_iterations = n ? : KEY_ITERATIONS_DEFAULT;
 		// case VERSION_CURRENT:
 			/*
@@ -244,6 +375,15 @@ extern crypto_t *encrypt_init(const char * const restrict i,
 		default:
 			die(_("We’ve reached an unreachable location in the code @ %s:%d:%s"), __FILE__, __LINE__, __func__);
 	}
+	/*
+	 * older versions only know about xz, and only the one way of
+	 * correcting errors (if any)
+	 */
+	z->compressor = z->version < VERSION_2026_10 ? IO_COMPRESSOR_XZ : io_get_compressor();
+	if (z->version < VERSION_2015_10)
+		z->correction = IO_CORRECTION_OFF;
+	else
+		z->correction = z->version < VERSION_2026_11 ? IO_CORRECTION_COMPAT : io_get_correction();
 	return z;
 }
 
@@ -254,6 +394,35 @@ static void *process(void *ptr)
 	if (!c || c->status != STATUS_INIT)
 		return NULL;
 
+	if (c->directory)
+	{
+		/*
+		 * strip leading directories and trailing /; everything from
+		 * here on (walking the directory included) is found relative
+		 * to its parent
+		 */
+		char ps = c->path[strlen(c->path) - 1];
+		if (ps == '/')
+			ps = '\0';
+#ifndef _WIN32
+		char *dir = strrchr(c->path, '/');
+#else
+		char *dir = strrchr(c->path, '\\');
+#endif
+		int at = AT_FDCWD;
+		if (dir)
+		{
+			*dir = '\0';
+			dir++;
+			at = openat(AT_FDCWD, *c->path ? c->path : "/", O_RDONLY | O_DIRECTORY);
+			char *p = c->path; /* dir points into it */
+			if (!(c->path = strdup(dir)))
+				die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, strlen(dir));
+			free(p);
+		}
+		c->misc = manifest_init(at, c->path);
+	}
+
 	if (!c->raw)
 		write_header(c);
 
@@ -287,7 +456,7 @@ static void *process(void *ptr)
 	 * of the IV and salt, both of which are auto-generated during
 	 * the encryption initialisation)
 	 */
-	io_extra_t iox = { iv_type, true };
+	io_extra_t iox = { iv_type, true, c->version >= VERSION_2026_10 && !c->raw };
 	io_encryption_init(c->output, c->cipher, c->hash, c->mode, c->mac, c->kdf_iterations, c->key, c->length, iox);
 	c->status = STATUS_RUNNING;
 	gcry_free(c->key);
@@ -309,7 +478,7 @@ static void *process(void *ptr)
 	 * everything from here will be compressed (if necessary)
 	 */
 	if (c->compressed)
-		io_compression_init(c->output);
+		io_compression_init(c->output, c->compressor);
 
 	io_encryption_checksum_init(c->output, c->hash);
 
@@ -317,44 +486,18 @@ static void *process(void *ptr)
 	{
 		file_type_e tp = FILE_DIRECTORY;
 		io_write(c->output, &tp, sizeof( byte_t ));
-		/*
-		 * strip leading directories and trailing /
-		 */
-		char ps = c->path[strlen(c->path) - 1];
-		if (ps == '/')
-			ps = '\0';
-		char *cwd = NULL;
-#ifndef _WIN32
-		char *dir = strrchr(c->path, '/');
-#else
-		char *dir = strrchr(c->path, '\\');
-#endif
-		if (dir)
-		{
-			*dir = '\0';
-			dir++;
-			cwd = getcwd(NULL, 0);
-			chdir(c->path);
-			free(c->path);
-			if (!(c->path = strdup(dir)))
-				die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, strlen(dir));
-		}
 		uint64_t l = htonll(strlen(c->path));
 		io_write(c->output, &l, sizeof l);
 		io_write(c->output, c->path, strlen(c->path));
 		c->total.offset = 1;
-		if (!(c->misc = gcry_calloc_secure(c->total.size, sizeof( link_count_t ))))
-			die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, c->total.size * sizeof( link_count_t ));
-		encrypt_directory(c, c->path);
-		for (uint64_t i = 0; i < c->total.size; i++)
-			if (((link_count_t *)c->misc)[i].path)
-				gcry_free(((link_count_t *)c->misc)[i].path);
-		gcry_free(c->misc);
-		if (cwd)
-		{
-			chdir(cwd);
-			gcry_free(cwd);
-		}
+		if (c->look_ahead)
+			ahead_init(c);
+		encrypt_directory(c);
+		if (c->ahead)
+			ahead_end(c);
+		io_open_ahead_end();
+		manifest_free(c->misc);
+		c->misc = NULL;
 	}
 	else
 	{
@@ -370,20 +513,27 @@ static void *process(void *ptr)
 	c->total.offset = c->total.size;
 
 	/*
-	 * write checksum
+	 * write checksum (since 2026.10 each chunk has its own MAC, which
+	 * makes both the checksum and the trailing MAC redundant)
 	 */
 	if (!c->raw)
 	{
-		uint8_t *cs = NULL;
-		size_t cl = 0;
-		io_encryption_checksum(c->output, &cs, &cl);
-		io_write(c->output, cs, cl);
-		gcry_free(cs);
+		if (!io_encryption_chunked(c->output))
+		{
+			uint8_t *cs = NULL;
+			size_t cl = 0;
+			io_encryption_checksum(c->output, &cs, &cl);
+			io_write(c->output, cs, cl);
+			gcry_free(cs);
+		}
 
 		write_random_data(c);
 	}
 
-	if (c->kdf_iterations)
+	if (c->indexed)
+		encrypt_index_end(c);
+
+	if (c->kdf_iterations && !io_encryption_chunked(c->output))
 	{
 		/*
 		 * using a key derivation function also gives a MAC
@@ -411,8 +561,13 @@ static inline void write_header(crypto_t *c)
 {
 	uint64_t head[3] = { htonll(HEADER_0), htonll(HEADER_1), htonll(get_version(c->version)) };
 	io_write(c->output, head, sizeof head);
-	if (c->version >= VERSION_2015_10 && !c->raw) /* only since 2015_10 do we support ecc (and only when not in raw mode) */
-		io_correction_init(c->output);
+	if (c->version >= VERSION_2026_11 && !c->raw) /* since 2026_11 the profile follows the header */
+	{
+		uint8_t b = c->correction;
+		io_write(c->output, &b, sizeof b);
+	}
+	if (c->correction != IO_CORRECTION_OFF && !c->raw) /* only since 2015_10 do we support ecc (and only when not in raw mode) */
+		io_correction_init(c->output, c->correction);
 	char *algos = NULL;
 	const char *u_cipher = cipher_name_from_id(c->cipher);
 	const char *u_hash = hash_name_from_id(c->hash);
@@ -470,7 +625,16 @@ static inline void write_verification_sum(crypto_t *c)
 static inline void write_metadata(crypto_t *c)
 {
 	if (c->directory)
-		c->total.size = count_entries(c, c->path);
+	{
+		/*
+		 * everything in the directory, found now so that it can be
+		 * counted, and then encrypted without looking for it again
+		 */
+		manifest_t *m = c->misc;
+		manifest_walk(c, m, m->at, m->arena, 0, 0);
+		manifest_links(m);
+		c->total.size = 1 + m->count;
+	}
 	else
 	{
 		c->total.size = io_seek(c->source, 0, SEEK_END);
@@ -497,12 +661,26 @@ static inline void write_metadata(crypto_t *c)
 		tlv_t t = { TAG_COMPRESSED, sizeof b, &b };
 		tlv_append(&tlv, t);
 	}
+	if (c->compressed && c->compressor != IO_COMPRESSOR_XZ)
+	{   /* older versions ignore this and assume xz, which will fail to decompress (rather than be mistaken for plaintext) */
+		byte_t b = c->compressor;
+		tlv_t t = { TAG_COMPRESSOR, sizeof b, &b };
+		tlv_append(&tlv, t);
+	}
 	if (c->directory)
 	{
 		bool b = c->directory;
 		tlv_t t = { TAG_DIRECTORY, sizeof b, &b };
 		tlv_append(&tlv, t);
 	}
+	if (c->directory && io_encryption_chunked(c->output))
+	{   /* entries can only be found by their offset if the data is in chunks */
+		c->indexed = true;
+		c->shared = c->compressed;
+		byte_t b = c->shared ? INDEX_SHARED : true;
+		tlv_t t = { TAG_INDEX, sizeof b, &b };
+		tlv_append(&tlv, t);
+	}
 	if (!c->directory && c->name && c->version >= VERSION_2015_01)
 	{   /* after 2012.11 unknown tags are ignored, and this tag doesn't impact anything */
 		tlv_t t = { TAG_FILENAME, strlen(c->name), c->name };
@@ -537,168 +715,528 @@ static inline void write_random_data(crypto_t *c)
 	return (void)c;
 }
 
-static int64_t count_entries(crypto_t *c, const char *dir)
+/*
+ * start the manifest off with the directory itself (which is not one of
+ * its entries, but is where all their paths begin) and the directory it
+ * is in, which everything is found from
+ */
+static manifest_t *manifest_init(int at, const char *root)
 {
-	struct dirent **eps = NULL;
-	int n = 0;
-	int64_t e = 1;
-	errno = 0;
-	if ((n = scandir(dir, &eps, NULL, NULL)))
-	{
-		for (int i = 0; i < n; ++i)
-		{
-			if (!strcmp(".", eps[i]->d_name) || !strcmp("..", eps[i]->d_name))
-				continue;
-			size_t l = strlen(eps[i]->d_name);
-			char *filename = NULL;
-			if (!asprintf(&filename, "%s/%s", dir, eps[i]->d_name))
-				die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, strlen(dir) + l + 2);
-			struct stat s;
-			c->follow_links ? stat(filename, &s) : lstat(filename, &s);
-			if (S_ISDIR(s.st_mode))
-				e += count_entries(c, filename);
-			else if (S_ISREG(s.st_mode))
-				e++;
-#ifndef _WIN32
-			else if (!c->follow_links && S_ISLNK(s.st_mode))
-				e++;
+	manifest_t *m = calloc(1, sizeof( manifest_t ));
+	if (!m)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, sizeof( manifest_t ));
+	m->at = at;
+	m->capacity = MANIFEST_ENTRIES;
+	if (!(m->entry = malloc(m->capacity * sizeof( manifest_entry_t ))))
+		die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, m->capacity * sizeof( manifest_entry_t ));
+	m->length = strlen(root) + sizeof( char );
+	for (m->size = MANIFEST_ARENA; m->size < m->length; m->size *= 2)
+		;
+	if (!(m->arena = malloc(m->size)))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, m->size);
+	memcpy(m->arena, root, m->length);
+	return m;
+}
+
+/*
+ * open a directory within another, without updating its access time if
+ * that’s allowed (it only is for our own directories)
+ */
+static int manifest_open(int at, const char *name)
+{
+	int f = -1;
+#ifdef O_NOATIME
+	if ((f = openat(at, name, O_RDONLY | O_DIRECTORY | O_NOATIME)) < 0 && errno == EPERM)
 #endif
-			gcry_free(filename);
-		}
+		f = openat(at, name, O_RDONLY | O_DIRECTORY);
+	return f;
+}
+
+/*
+ * walk a directory (name, within the directory at, whose own path is at
+ * dir in the arena) adding everything in it to the manifest, with each
+ * subdirectory followed immediately by what’s in it; entries are looked
+ * up relative to the directory they’re in, and only the once
+ */
+static void manifest_walk(crypto_t *c, manifest_t *m, int at, const char *name, size_t dir, uint32_t depth)
+{
+	int f = manifest_open(at, name);
+	DIR *d = f < 0 ? NULL : fdopendir(f);
+	if (!d)
+	{
+		if (f >= 0)
+			close(f);
+		return;
+	}
+	if (depth > m->depth)
+		m->depth = depth;
+	for (struct dirent *e; (e = readdir(d)); )
+	{
+		if (!strcmp(".", e->d_name) || !strcmp("..", e->d_name))
+			continue;
+		struct stat s;
+		if (fstatat(dirfd(d), e->d_name, &s, c->follow_links ? 0 : AT_SYMLINK_NOFOLLOW))
+			continue;
+		file_type_e tp;
+		if (S_ISDIR(s.st_mode))
+			tp = FILE_DIRECTORY;
+		else if (S_ISREG(s.st_mode))
+			tp = FILE_REGULAR;
+		else if (!c->follow_links && S_ISLNK(s.st_mode))
+			tp = FILE_SYMLINK;
+		else
+			continue;
+		size_t p = manifest_add(m, dir, depth, e->d_name, &s, tp);
+		if (tp == FILE_DIRECTORY)
+			manifest_walk(c, m, dirfd(d), e->d_name, p, depth + 1);
 	}
-	for (int i = 0; i < n; ++i)
-		gcry_free(eps[i]);
-	gcry_free(eps);
-	return e;
+	closedir(d);
+	return;
 }
 
-static void encrypt_directory(crypto_t *c, const char *dir)
+/*
+ * add an entry to the manifest, its path being that of its directory
+ * (already in the arena) and its name; returns where its path starts
+ */
+static size_t manifest_add(manifest_t *m, size_t dir, uint32_t depth, const char *name, const struct stat *s, file_type_e tp)
 {
-	struct dirent **eps = NULL;
-	int n = 0;
-	if ((n = scandir(dir, &eps, NULL, NULL)))
+	if (m->count == m->capacity)
+	{
+		manifest_entry_t *x = realloc(m->entry, 2 * m->capacity * sizeof( manifest_entry_t ));
+		if (!x)
+			die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, 2 * m->capacity * sizeof( manifest_entry_t ));
+		m->entry = x;
+		m->capacity *= 2;
+	}
+	size_t dl = strlen(m->arena + dir);
+	size_t nl = strlen(name);
+	size_t z = dl + nl + 2 * sizeof( char );
+	if (m->length + z > m->size)
 	{
-		for (int i = 0; i < n && c->status == STATUS_RUNNING; ++i)
+		size_t y = m->size;
+		while (m->length + z > y)
+			y *= 2;
+		char *x = realloc(m->arena, y);
+		if (!x)
+			die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, y);
+		m->arena = x;
+		m->size = y;
+	}
+	size_t p = m->length;
+	char *x = m->arena + p;
+	memcpy(x, m->arena + dir, dl);
+	x[dl] = '/';
+	memcpy(x + dl + 1, name, nl + 1);
+	m->length += z;
+	manifest_entry_t *e = &m->entry[m->count++];
+	e->size = tp == FILE_REGULAR ? (uint64_t)s->st_size : 0;
+	e->path = p;
+	e->name = p + dl + 1;
+	e->depth = depth;
+	e->dev = s->st_dev;
+	e->inode = s->st_ino;
+	e->type = tp;
+	if ((e->linked = tp != FILE_DIRECTORY && s->st_nlink > 1))
+		m->links++;
+	return p;
+}
+
+/*
+ * make room to keep track of the files with other links (at most half
+ * full, so that they’re found without much probing)
+ */
+static void manifest_links(manifest_t *m)
+{
+	uint64_t z = 0x10;
+	while (z < 2 * m->links)
+		z *= 2;
+	if (!(m->link = calloc(z, sizeof( manifest_link_t ))))
+		die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, z * sizeof( manifest_link_t ));
+	m->mask = z - 1;
+	return;
+}
+
+static void manifest_free(manifest_t *m)
+{
+	if (!m)
+		return;
+	if (m->at >= 0)
+		close(m->at);
+	free(m->entry);
+	free(m->arena);
+	free(m->link);
+	free(m);
+	return;
+}
+
+static void encrypt_directory(crypto_t *c)
+{
+	manifest_t *m = c->misc;
+	/*
+	 * the directories above the current entry, each opened from the
+	 * one above it, so every entry is found from the directory it’s in
+	 */
+	int *dirs = malloc((m->depth + 2) * sizeof( int ));
+	if (!dirs)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, (m->depth + 2) * sizeof( int ));
+	uint32_t top = 0;
+	dirs[top] = manifest_open(m->at, m->arena);
+	uint64_t ahead = 0;
+	/*
+	 * with a table of contents, small files share a compressed stream:
+	 * where it starts, and how much has gone in it since
+	 */
+	int64_t segment = 0;
+	uint64_t span = 0;
+	bool segmented = false;
+	for (uint64_t i = 0; i < m->count && c->status == STATUS_RUNNING; i++)
+	{
+		manifest_entry_t *e = &m->entry[i];
+		const char *filename = m->arena + e->path;
+		const char *name = m->arena + e->name;
+		for (; top > e->depth; top--)
+			if (dirs[top] >= 0)
+				close(dirs[top]);
+		int at = dirs[top];
+		if (e->type == FILE_DIRECTORY)
+			dirs[++top] = at < 0 ? -1 : manifest_open(at, name);
+		/*
+		 * have the next few files in this directory opened while this
+		 * one is being dealt with (or, given a look-ahead, as many as
+		 * there’s room for read by the workers, this one included;
+		 * they find each from the top, as they’re ahead of dirs)
+		 */
+		for (ahead = ahead > i ? ahead : i + !c->ahead; ahead < m->count && (c->ahead || ahead <= i + IO_OPEN_AHEAD); ahead++)
 		{
-			if (!strcmp(".", eps[i]->d_name) || !strcmp("..", eps[i]->d_name))
+			manifest_entry_t *x = &m->entry[ahead];
+			if (!c->ahead && x->depth != top)
+				break;
+			if (x->type != FILE_REGULAR)
 				continue;
-			uint64_t l = strlen(eps[i]->d_name);
-			char *filename = NULL;
-			if (!asprintf(&filename, "%s/%s", dir, eps[i]->d_name))
-				die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, strlen(dir) + l + 2);
-			file_type_e tp;
-			struct stat s;
-			c->follow_links ? stat(filename, &s) : lstat(filename, &s);
-			char *ln = NULL;
-			switch (s.st_mode & S_IFMT)
-			{
-				case S_IFDIR:
-					tp = FILE_DIRECTORY;
-					break;
+			if (!c->ahead)
+				io_open_ahead(dirs[top], m->arena + x->name, O_RDONLY | F_RDLCK | O_BINARY, S_IRUSR | S_IWUSR);
+			else if (!ahead_queue(c, m->arena + x->path, x->size))
+				break;
+		}
+		/*
+		 * the workers read the files in the same order, so if this one
+		 * was read ahead, it’s next
+		 */
+		ahead_job_t job = { 0 };
+		bool ready = c->ahead && ahead_take(c, filename, &job);
+		file_type_e tp = e->type;
+		const char *ln = NULL;
+		switch (tp)
+		{
+			case FILE_SYMLINK:
+				if ((ln = encrypt_link(c, i)))
+					tp = FILE_LINK;
+				break;
+			case FILE_REGULAR:
+				if ((ln = encrypt_link(c, i)))
+					tp = FILE_LINK;
+				else if (ready ? job.stored : encrypt_stored(c, at, name, e->size))
+					tp = FILE_STORED;
+				break;
+			default:
+				break;
+		}
+		io_write(c->output, &tp, sizeof( byte_t ));
+		uint64_t l = htonll(strlen(filename));
+		io_write(c->output, &l, sizeof l);
+		io_write(c->output, filename, strlen(filename));
+		span += sizeof( byte_t ) + sizeof l + strlen(filename);
+		switch (tp)
+		{
+			case FILE_DIRECTORY:
+				if (c->indexed)
+					encrypt_index(c, tp, filename, NULL, 0, 0, 0, 0);
+				break;
+			case FILE_SYMLINK:
 #ifndef _WIN32
-				case S_IFLNK:
-					tp = (ln = encrypt_link(c, filename, s)) ? FILE_LINK : FILE_SYMLINK;
-					break;
-#endif
-				case S_IFREG:
-					tp = (ln = encrypt_link(c, filename, s)) ? FILE_LINK : FILE_REGULAR;
-					break;
-				default:
-					gcry_free(filename);
-					continue;
-			}
-			io_write(c->output, &tp, sizeof( byte_t ));
-			l = htonll(strlen(filename));
-			io_write(c->output, &l, sizeof l);
-			io_write(c->output, filename, strlen(filename));
-			switch (tp)
-			{
-				case FILE_DIRECTORY:
+				{
 					/*
-					 * recurse into each directory as necessary
+					 * store the link instead of the file/directory
+					 * it points to
 					 */
-					encrypt_directory(c, filename);
-					break;
-				case FILE_SYMLINK:
-#ifndef _WIN32
+					char *sl = gcry_malloc_secure(sizeof( byte_t ));
+					for (l = BLOCK_SIZE; ; l += BLOCK_SIZE)
 					{
-						/*
-						 * store the link instead of the file/directory
-						 * it points to
-						 */
-						char *sl = gcry_malloc_secure(sizeof( byte_t ));
-						for (l = BLOCK_SIZE; ; l += BLOCK_SIZE)
-						{
-							char *x = gcry_realloc(sl, l + sizeof( byte_t ));
-							if (!x)
-								die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, l + sizeof( byte_t ) );
-							sl = x;
-							if (readlink(filename, sl, BLOCK_SIZE + l) < (int64_t)l)
-								break;
-						}
-						l = htonll(strlen(sl));
-						io_write(c->output, &l, sizeof l);
-						io_write(c->output, sl, strlen(sl));
+						char *x = gcry_realloc(sl, l + sizeof( byte_t ));
+						if (!x)
+							die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, l + sizeof( byte_t ) );
+						sl = x;
+						if (readlinkat(at, name, sl, BLOCK_SIZE + l) < (int64_t)l)
+							break;
 					}
+					l = htonll(strlen(sl));
+					io_write(c->output, &l, sizeof l);
+					io_write(c->output, sl, strlen(sl));
+					span += sizeof l + strlen(sl);
+					if (c->indexed)
+						encrypt_index(c, tp, filename, sl, 0, 0, 0, 0);
+				}
 #endif
-					break;
-				case FILE_LINK:
+				break;
+			case FILE_LINK:
 #ifndef _WIN32
+				/*
+				 * store a hard link; it’s basically the same as a
+				 * symlink at this point, but will be handled
+				 * differently upon decryption
+				 */
+				l = htonll(strlen(ln));
+				io_write(c->output, &l, sizeof l);
+				io_write(c->output, ln, strlen(ln));
+				span += sizeof l + strlen(ln);
+				if (c->indexed)
+					encrypt_index(c, tp, filename, ln, 0, 0, 0, 0);
+#endif
+				break;
+			case FILE_REGULAR:
+			case FILE_STORED:
+				/*
+				 * when we have a file:
+				 */
+				if (c->source)
+					io_close(c->source);
+				c->current.offset = 0;
+				if (ready)
+				{
+					c->source = job.source;
+					job.source = NULL;
+					c->current.size = job.size;
+				}
+				else
+				{
+					c->source = io_open_at(at, name, O_RDONLY | F_RDLCK | O_BINARY, S_IRUSR | S_IWUSR);
+					c->current.size = io_seek(c->source, 0, SEEK_END);
+					io_seek(c->source, 0, SEEK_SET);
+				}
+				uint64_t z = htonll(c->current.size);
+				io_write(c->output, &z, sizeof z);
+				span += sizeof z;
+				/*
+				 * the entry itself is compressed (along with
+				 * everything else) but not the file contents;
+				 * when there’s a table of contents, the file
+				 * contents are compressed on their own, so they
+				 * can be found (and decompressed) without
+				 * anything before them; small files instead
+				 * share a stream (of limited size) and can be
+				 * found by how far into it they are
+				 */
+				bool shared = c->shared && tp == FILE_REGULAR && c->current.size < INDEX_SHARED_MAXIMUM;
+				if (shared && (!segmented || span >= INDEX_SHARED_SPAN))
+				{
+					io_compression_suspend(c->output);
+					segment = io_tell_plain(c->output);
+					io_compression_resume(c->output);
+					segmented = true;
+					span = 0;
+				}
+				uint64_t skip = span;
+				if (!shared && (tp == FILE_STORED || c->indexed))
+					io_compression_suspend(c->output);
+				int64_t o = shared ? segment : c->indexed ? io_tell_plain(c->output) : 0;
+				if (!shared && tp == FILE_REGULAR && !job.packed)
+					io_compression_resume(c->output);
+				if (ready && job.length)
+				{
 					/*
-					 * store a hard link; it’s basically the same as a
-					 * symlink at this point, but will be handled
-					 * differently upon decryption
+					 * whatever was read ahead (the whole file, if
+					 * it’s already been compressed) and then the
+					 * rest, if there is any
 					 */
-					l = htonll(strlen(ln));
-					io_write(c->output, &l, sizeof l);
-					io_write(c->output, ln, strlen(ln));
-#endif
-					break;
-				case FILE_REGULAR:
+					io_write(c->output, job.data, job.length);
+					c->current.offset = job.packed ? c->current.size : job.length;
+				}
+				encrypt_file(c);
+				if (shared)
+				{
 					/*
-					 * when we have a file:
+					 * how much of the stream the file takes up
+					 * isn’t known
 					 */
-					if (c->source)
-						io_close(c->source);
-					c->source = io_open(filename, O_RDONLY | F_RDLCK | O_BINARY, S_IRUSR | S_IWUSR);
-					c->current.offset = 0;
-					c->current.size = io_seek(c->source, 0, SEEK_END);
-					uint64_t z = htonll(c->current.size);
-					io_write(c->output, &z, sizeof z);
-					io_seek(c->source, 0, SEEK_SET);
-					encrypt_file(c);
-					c->current.offset = c->current.size;
-					io_close(c->source);
-					c->source = NULL;
-					break;
-			}
-			gcry_free(filename);
-			c->total.offset++;
+					encrypt_index(c, tp, filename, NULL, c->current.size, o, 0, skip);
+					span += c->current.size;
+				}
+				else if (c->indexed)
+				{
+					io_compression_suspend(c->output);
+					segment = io_tell_plain(c->output);
+					encrypt_index(c, tp, filename, NULL, c->current.size, o, segment - o, 0);
+					/*
+					 * which starts another stream, for any small
+					 * files after it
+					 */
+					segmented = true;
+					span = 0;
+				}
+				if (!shared && (tp == FILE_STORED || c->indexed))
+					io_compression_resume(c->output);
+				c->current.offset = c->current.size;
+				io_close(c->source);
+				c->source = NULL;
+				break;
 		}
-		/*
-		 * no more files in this directory
-		 */
+		ahead_release(c, &job);
+		c->total.offset++;
 	}
-	for (int i = 0; i < n; ++i)
-		gcry_free(eps[i]);
-	gcry_free(eps);
+	for (uint32_t j = 0; j <= top; j++)
+		if (dirs[j] >= 0)
+			close(dirs[j]);
+	free(dirs);
+	return;
+}
+
+/*
+ * add an entry to the table of contents: its type, path, what it links
+ * to (if anything), and for files their size, and where their data is
+ * (and how much of it there is, after compression) in the decrypted data;
+ * when small files share streams, where the stream is, and how far into
+ * it (before compression) the file starts
+ */
+static void encrypt_index(crypto_t *c, file_type_e tp, const char *path, const char *link, uint64_t size, uint64_t offset, uint64_t length, uint64_t skip)
+{
+	uint64_t pl = strlen(path);
+	uint64_t ll = link ? strlen(link) : 0;
+	size_t n = c->shared ? 4 : 3;
+	size_t z = sizeof( byte_t ) + (2 + n) * sizeof( uint64_t ) + pl + ll;
+	uint8_t *x = realloc(c->index, c->index_length + z);
+	if (!x)
+		die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, c->index_length + z);
+	c->index = x;
+	x += c->index_length;
+	*x++ = tp;
+	uint64_t v[] = { htonll(pl), htonll(ll), htonll(size), htonll(offset), htonll(length), htonll(skip) };
+	memcpy(x, &v[0], sizeof v[0]);
+	x += sizeof v[0];
+	memcpy(x, path, pl);
+	x += pl;
+	memcpy(x, &v[1], sizeof v[1]);
+	x += sizeof v[1];
+	if (ll)
+		memcpy(x, link, ll);
+	x += ll;
+	memcpy(x, &v[2], n * sizeof v[0]);
+	c->index_length += z;
+	c->index_entries++;
 	return;
 }
 
-static char *encrypt_link(crypto_t *c, char *filename, struct stat s)
+/*
+ * the table of contents isn’t compressed, so it can be read without
+ * anything before it; last of all comes where it starts, lined up so
+ * that it ends on a cipher block (the final chunk is then not padded,
+ * which means it can be found from the end)
+ */
+static void encrypt_index_end(crypto_t *c)
+{
+	io_compression_suspend(c->output);
+	uint64_t o = io_tell_plain(c->output);
+	/*
+	 * with small files sharing streams the table is as big as the
+	 * files, so it gets a (compressed) stream of its own
+	 */
+	if (c->shared)
+		io_compression_resume(c->output);
+	uint64_t n = htonll(c->index_entries);
+	io_write(c->output, &n, sizeof n);
+	io_write(c->output, c->index, c->index_length);
+	io_compression_suspend(c->output);
+	size_t b = gcry_cipher_get_algo_blklen(c->cipher);
+	size_t z = (b - (io_tell_plain(c->output) + sizeof o) % b) % b;
+	uint8_t p[0x20] = { 0x00 }; /* more than any cipher block */
+	io_write(c->output, p, z);
+	o = htonll(o);
+	io_write(c->output, &o, sizeof o);
+	return;
+}
+
+/*
+ * the path of an earlier entry which is the same file as this one, if
+ * there is one; otherwise, if this file has other links, it becomes
+ * the one they link to
+ */
+static const char *encrypt_link(crypto_t *c, uint64_t i)
 {
-	link_count_t *ln = (link_count_t *)c->misc;
 #ifndef _WIN32
-	for (uint64_t i = 0; i < c->total.offset; i++)
-		if (ln[i].dev == s.st_dev && ln[i].inode == s.st_ino)
-			return ln[i].path;
+	manifest_t *m = c->misc;
+	manifest_entry_t *e = &m->entry[i];
+	if (!e->linked)
+		return NULL;
+	uint64_t h = ((uint64_t)e->inode ^ (uint64_t)e->dev << 32 ^ (uint64_t)e->dev >> 32) * 0x9E3779B97F4A7C15ULL;
+	for (h ^= h >> 32; ; h++)
+	{
+		manifest_link_t *x = &m->link[h & m->mask];
+		if (!x->entry)
+		{
+			x->dev = e->dev;
+			x->inode = e->inode;
+			x->entry = i + 1;
+			break;
+		}
+		if (x->dev == e->dev && x->inode == e->inode)
+			return m->arena + m->entry[x->entry - 1].path;
+	}
+#else
+	(void)c;
+	(void)i;
 #endif
-	ln[c->total.offset].dev = s.st_dev;
-	ln[c->total.offset].inode = s.st_ino;
-	ln[c->total.offset].path = strdup(filename);
 	return NULL;
 }
 
+static bool encrypt_stored(crypto_t *c, int at, const char *filename, uint64_t size)
+{
+	/*
+	 * decide whether a file is worth compressing: anything that looks
+	 * like it’s already compressed isn’t, and neither is anything where
+	 * a few samples suggest every byte value is (roughly) as likely as
+	 * any other
+	 */
+	if (!c->compressed || c->version < VERSION_2026_10 || size < STORED_MINIMUM)
+		return false;
+	int64_t f = openat(at, filename, O_RDONLY | O_BINARY);
+	if (f < 0)
+		return false;
+	uint8_t sample[STORED_SAMPLE];
+	uint32_t histogram[0x100] = { 0 };
+	uint64_t n = 0;
+	bool stored = false;
+	for (int i = 0; i < 3 && !stored; i++)
+	{
+		/*
+		 * from the beginning, middle and end
+		 */
+		off_t o = i * (size - STORED_SAMPLE) / 2;
+		if (lseek(f, o, SEEK_SET) != o)
+			break;
+		ssize_t r = read(f, sample, sizeof sample);
+		if (r <= 0)
+			break;
+		if (!i)
+			for (size_t j = 0; j < sizeof STORED_MAGIC / sizeof STORED_MAGIC[0]; j++)
+				if ((size_t)r >= STORED_MAGIC[j].offset + STORED_MAGIC[j].length && !memcmp(sample + STORED_MAGIC[j].offset, STORED_MAGIC[j].magic, STORED_MAGIC[j].length))
+					stored = true;
+		for (ssize_t j = 0; j < r; j++)
+			histogram[sample[j]]++;
+		n += r;
+	}
+	memset(sample, 0x00, sizeof sample);
+	close(f);
+	if (stored || !n)
+		return stored;
+	/*
+	 * the sum of the squares of the byte counts is close to n²/256 for
+	 * random data, and grows the more skewed the distribution is
+	 */
+	uint64_t sq = 0;
+	for (int i = 0; i < 0x100; i++)
+		sq += (uint64_t)histogram[i] * histogram[i];
+	return sq * 0x100 < n * n * 5 / 4;
+}
+
 static void encrypt_stream(crypto_t *c)
 {
 	bool b = true;
@@ -736,20 +1274,195 @@ static void encrypt_stream(crypto_t *c)
 
 static void encrypt_file(crypto_t *c)
 {
-	uint8_t buffer[BLOCK_SIZE];
-	for (c->current.offset = 0; c->current.offset < c->current.size && c->status == STATUS_RUNNING; c->current.offset += BLOCK_SIZE)
+	/*
+	 * move as much as the IO layer can handle in one go (but don’t
+	 * bother with a huge buffer for a small file)
+	 */
+	size_t t = io_get_buffer_size();
+	if (t > c->current.size)
+		t = c->current.size ? : sizeof( byte_t );
+	uint8_t *buffer = malloc(t);
+	if (!buffer)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, t);
+	for (; c->current.offset < c->current.size && c->status == STATUS_RUNNING; c->current.offset += t)
 	{
 		errno = EXIT_SUCCESS;
 		/*
-		 * read plaintext file, write encrypted data
+		 * read plaintext file (straight from the page cache if it’s
+		 * mapped), write encrypted data
 		 */
-		int64_t r = io_read(c->source, buffer, BLOCK_SIZE);
+		const void *p = buffer;
+		int64_t r = io_map(c->source, &p, t);
+		if (r < 0)
+			r = io_read(c->source, buffer, t);
 		if (r < 0)
 		{
 			c->status = STATUS_FAILED_IO;
 			break;
 		}
-		io_write(c->output, buffer, r);
+		io_write(c->output, p, r);
 	}
+	memset(buffer, 0x00, t);
+	free(buffer);
+	return;
+}
+
+static void ahead_init(crypto_t *c)
+{
+	ahead_t *a = calloc(1, sizeof( ahead_t ));
+	if (!a)
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, sizeof( ahead_t ));
+	a->count = c->workers ? : lzma_cputhreads() ? : 1;
+	if (!(a->threads = calloc(a->count, sizeof( pthread_t ))))
+		die(_("Out of memory @ %s:%d:%s [%zu]"), __FILE__, __LINE__, __func__, a->count * sizeof( pthread_t ));
+	pthread_mutex_init(&a->mutex, NULL);
+	pthread_cond_init(&a->queued, NULL);
+	pthread_cond_init(&a->done, NULL);
+	c->ahead = a;
+	for (uint32_t i = 0; i < a->count; i++)
+		pthread_create(&a->threads[i], NULL, ahead_worker, c);
+	return;
+}
+
+static void *ahead_worker(void *ptr)
+{
+	crypto_t *c = ptr;
+	ahead_t *a = c->ahead;
+	pthread_mutex_lock(&a->mutex);
+	while (true)
+	{
+		while (!a->quit && a->next == a->tail)
+			pthread_cond_wait(&a->queued, &a->mutex);
+		if (a->quit)
+			break;
+		/*
+		 * take the oldest file nobody has started on yet; it has
+		 * first claim on whatever room there is
+		 */
+		ahead_job_t *x = &a->job[a->next++ % AHEAD_JOBS];
+		ahead_job_t j = { x->path, NULL, NULL, x->size, 0, false, false, false };
+		pthread_mutex_unlock(&a->mutex);
+
+		manifest_t *m = c->misc;
+		j.stored = encrypt_stored(c, m->at, j.path, j.size);
+		j.source = io_open_at(m->at, j.path, O_RDONLY | F_RDLCK | O_BINARY, S_IRUSR | S_IWUSR);
+		uint64_t r = 0;
+		if (j.source)
+		{
+			j.size = io_seek(j.source, 0, SEEK_END);
+			io_seek(j.source, 0, SEEK_SET);
+			/*
+			 * read as much as there’s room for (perhaps nothing,
+			 * but never wait for room, as that’s only made once
+			 * earlier files have been written)
+			 */
+			pthread_mutex_lock(&a->mutex);
+			r = a->used < c->look_ahead ? c->look_ahead - a->used : 0;
+			if (r > j.size)
+				r = j.size;
+			a->used += r;
+			pthread_mutex_unlock(&a->mutex);
+		}
+		if (r && !(j.data = malloc(r)))
+			die(_("Out of memory @ %s:%d:%s [%" PRIu64 "]"), __FILE__, __LINE__, __func__, r);
+		for (ssize_t e = 0; j.length < r; j.length += e)
+			if ((e = io_read(j.source, j.data + j.length, r - j.length)) <= 0)
+				break;
+		/*
+		 * when each file is compressed on its own, that can be done
+		 * now too
+		 */
+		uint8_t *p = NULL;
+		ssize_t z;
+		if (c->indexed && c->compressed && !j.stored && j.size && j.length == j.size && !(c->shared && j.size < INDEX_SHARED_MAXIMUM) && (z = io_compress_all(c->compressor, j.data, j.length, &p)) >= 0)
+		{
+			memset(j.data, 0x00, j.length);
+			free(j.data);
+			j.data = p;
+			j.length = z;
+			j.packed = true;
+		}
+
+		pthread_mutex_lock(&a->mutex);
+		a->used = a->used - r + j.length;
+		j.done = true;
+		*x = j;
+		pthread_cond_broadcast(&a->done);
+	}
+	pthread_mutex_unlock(&a->mutex);
+	return NULL;
+}
+
+static bool ahead_queue(crypto_t *c, const char *path, uint64_t size)
+{
+	ahead_t *a = c->ahead;
+	pthread_mutex_lock(&a->mutex);
+	bool q = a->tail - a->head < AHEAD_JOBS;
+	if (q)
+	{
+		ahead_job_t *x = &a->job[a->tail++ % AHEAD_JOBS];
+		memset(x, 0x00, sizeof( ahead_job_t ));
+		x->path = path;
+		x->size = size;
+		pthread_cond_signal(&a->queued);
+	}
+	pthread_mutex_unlock(&a->mutex);
+	return q;
+}
+
+static bool ahead_take(crypto_t *c, const char *path, ahead_job_t *j)
+{
+	ahead_t *a = c->ahead;
+	pthread_mutex_lock(&a->mutex);
+	ahead_job_t *x = &a->job[a->head % AHEAD_JOBS];
+	bool t = a->head != a->tail && x->path == path;
+	if (t)
+	{
+		while (!x->done)
+			pthread_cond_wait(&a->done, &a->mutex);
+		*j = *x;
+		a->head++;
+	}
+	pthread_mutex_unlock(&a->mutex);
+	return t && j->source;
+}
+
+static void ahead_release(crypto_t *c, ahead_job_t *j)
+{
+	ahead_t *a = c->ahead;
+	if (j->data)
+	{
+		memset(j->data, 0x00, j->length);
+		free(j->data);
+		pthread_mutex_lock(&a->mutex);
+		a->used -= j->length;
+		pthread_mutex_unlock(&a->mutex);
+	}
+	if (j->source)
+		io_close(j->source);
+	memset(j, 0x00, sizeof( ahead_job_t ));
+	return;
+}
+
+static void ahead_end(crypto_t *c)
+{
+	ahead_t *a = c->ahead;
+	pthread_mutex_lock(&a->mutex);
+	a->quit = true;
+	pthread_cond_broadcast(&a->queued);
+	pthread_mutex_unlock(&a->mutex);
+	for (uint32_t i = 0; i < a->count; i++)
+		pthread_join(a->threads[i], NULL);
+	/*
+	 * anything left over (only if cancelled)
+	 */
+	for (; a->head != a->tail; a->head++)
+		ahead_release(c, &a->job[a->head % AHEAD_JOBS]);
+	pthread_mutex_destroy(&a->mutex);
+	pthread_cond_destroy(&a->queued);
+	pthread_cond_destroy(&a->done);
+	free(a->threads);
+	free(a);
+	c->ahead = NULL;
 	return;
 }
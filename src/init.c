@@ -73,18 +73,38 @@ extern args_t init(int argc, char **argv)
 			strdup(DEFAULT_HASH),
 			strdup(DEFAULT_MODE),
 			strdup(DEFAULT_MAC),
+			strdup(DEFAULT_COMPRESSOR),
+			strdup(DEFAULT_ECC),
+			IO_COMPRESS_LEVEL_DEFAULT,
 			KEY_ITERATIONS_DEFAULT,
+			IO_BUFFER_DEFAULT / MEGABYTE,
+			IO_THREADS_DEFAULT,
+			0,    /* xz block size; let liblzma decide */
+			0,    /* xz memory limit; none */
+			0,    /* look ahead; none */
+			0,    /* write behind; none */
+			0,    /* range offset */
+			0,    /* range length; the rest */
 			NULL, /* key file */
 			NULL, /* password */
 			NULL, /* source */
 			NULL, /* output */
 			strdup(get_version_string(VERSION_CURRENT)), /* compatibility */
+			NULL, /* extract */
 			KEY_SOURCE_PASSWORD,
 			true,    /* compress */
 			false,   /* follow links */
 			true,    /* show the gui if available */
 			true,    /* show the cli if necessary */
-			false    /* skip header/verification */
+			false,   /* skip header/verification */
+			false,   /* pipeline */
+			false,   /* io_uring */
+			false,   /* drop cache */
+			false,   /* direct */
+			false,   /* mmap */
+			false,   /* range */
+			false,   /* list */
+			false    /* scrub */
 	};
 
 	/*
@@ -122,6 +142,25 @@ extern args_t init(int argc, char **argv)
 
 			if (!strncmp(CONF_COMPRESS, line, strlen(CONF_COMPRESS)) && isspace((unsigned char)line[strlen(CONF_COMPRESS)]))
 				a.compress = parse_config_boolean(CONF_COMPRESS, line, a.compress);
+			else if (!strncmp(CONF_COMPRESSOR, line, strlen(CONF_COMPRESSOR)) && isspace((unsigned char)line[strlen(CONF_COMPRESSOR)]))
+			{
+				free(a.compressor);
+				a.compressor = parse_config_tail(CONF_COMPRESSOR, line);
+			}
+			else if (!strncmp(CONF_ECC, line, strlen(CONF_ECC)) && isspace((unsigned char)line[strlen(CONF_ECC)]))
+			{
+				free(a.ecc);
+				a.ecc = parse_config_tail(CONF_ECC, line);
+			}
+			else if (!strncmp(CONF_COMPRESS_LEVEL, line, strlen(CONF_COMPRESS_LEVEL)) && isspace((unsigned char)line[strlen(CONF_COMPRESS_LEVEL)]))
+			{
+				char *lvl = parse_config_tail(CONF_COMPRESS_LEVEL, line);
+				if (lvl)
+				{
+					a.compress_level = strtol(lvl, NULL, 0);
+					free(lvl);
+				}
+			}
 			else if (!strncmp(CONF_FOLLOW, line, strlen(CONF_FOLLOW)) && isspace((unsigned char)line[strlen(CONF_FOLLOW)]))
 				a.follow = parse_config_boolean(CONF_FOLLOW, line, a.follow);
 			else if (!strncmp(CONF_CIPHER, line, strlen(CONF_CIPHER)) && isspace((unsigned char)line[strlen(CONF_CIPHER)]))
@@ -158,6 +197,60 @@ extern args_t init(int argc, char **argv)
 					free(itr);
 				}
 			}
+			else if (!strncmp(CONF_IO_BUFFER, line, strlen(CONF_IO_BUFFER)) && isspace((unsigned char)line[strlen(CONF_IO_BUFFER)]))
+			{
+				char *buf = parse_config_tail(CONF_IO_BUFFER, line);
+				if (buf)
+				{
+					a.io_buffer = strtoull(buf, NULL, 0);
+					free(buf);
+				}
+			}
+			else if (!strncmp(CONF_LOOK_AHEAD, line, strlen(CONF_LOOK_AHEAD)) && isspace((unsigned char)line[strlen(CONF_LOOK_AHEAD)]))
+			{
+				char *ahd = parse_config_tail(CONF_LOOK_AHEAD, line);
+				if (ahd)
+				{
+					a.look_ahead = strtoull(ahd, NULL, 0);
+					free(ahd);
+				}
+			}
+			else if (!strncmp(CONF_WRITE_BEHIND, line, strlen(CONF_WRITE_BEHIND)) && isspace((unsigned char)line[strlen(CONF_WRITE_BEHIND)]))
+			{
+				char *bhd = parse_config_tail(CONF_WRITE_BEHIND, line);
+				if (bhd)
+				{
+					a.write_behind = strtoull(bhd, NULL, 0);
+					free(bhd);
+				}
+			}
+			else if (!strncmp(CONF_THREADS, line, strlen(CONF_THREADS)) && isspace((unsigned char)line[strlen(CONF_THREADS)]))
+			{
+				char *thr = parse_config_tail(CONF_THREADS, line);
+				if (thr)
+				{
+					a.threads = strtoul(thr, NULL, 0);
+					free(thr);
+				}
+			}
+			else if (!strncmp(CONF_XZ_BLOCK, line, strlen(CONF_XZ_BLOCK)) && isspace((unsigned char)line[strlen(CONF_XZ_BLOCK)]))
+			{
+				char *blk = parse_config_tail(CONF_XZ_BLOCK, line);
+				if (blk)
+				{
+					a.xz_block = strtoull(blk, NULL, 0);
+					free(blk);
+				}
+			}
+			else if (!strncmp(CONF_XZ_MEMLIMIT, line, strlen(CONF_XZ_MEMLIMIT)) && isspace((unsigned char)line[strlen(CONF_XZ_MEMLIMIT)]))
+			{
+				char *mem = parse_config_tail(CONF_XZ_MEMLIMIT, line);
+				if (mem)
+				{
+					a.xz_memlimit = strtoull(mem, NULL, 0);
+					free(mem);
+				}
+			}
 			else if (!strncmp(CONF_KEY, line, strlen(CONF_KEY)) && isspace((unsigned char)line[strlen(CONF_KEY)]))
 			{
 				char *k = parse_config_tail(CONF_KEY, line);
@@ -169,6 +262,16 @@ extern args_t init(int argc, char **argv)
 			}
 			else if (!strncmp(CONF_SKIP_HEADER, line, strlen(CONF_SKIP_HEADER)) && isspace((unsigned char)line[strlen(CONF_SKIP_HEADER)]))
 				a.raw = parse_config_boolean(CONF_SKIP_HEADER, line, a.raw);
+			else if (!strncmp(CONF_PIPELINE, line, strlen(CONF_PIPELINE)) && isspace((unsigned char)line[strlen(CONF_PIPELINE)]))
+				a.pipeline = parse_config_boolean(CONF_PIPELINE, line, a.pipeline);
+			else if (!strncmp(CONF_IO_URING, line, strlen(CONF_IO_URING)) && isspace((unsigned char)line[strlen(CONF_IO_URING)]))
+				a.io_uring = parse_config_boolean(CONF_IO_URING, line, a.io_uring);
+			else if (!strncmp(CONF_DROP_CACHE, line, strlen(CONF_DROP_CACHE)) && isspace((unsigned char)line[strlen(CONF_DROP_CACHE)]))
+				a.drop_cache = parse_config_boolean(CONF_DROP_CACHE, line, a.drop_cache);
+			else if (!strncmp(CONF_DIRECT, line, strlen(CONF_DIRECT)) && isspace((unsigned char)line[strlen(CONF_DIRECT)]))
+				a.direct = parse_config_boolean(CONF_DIRECT, line, a.direct);
+			else if (!strncmp(CONF_MMAP, line, strlen(CONF_MMAP)) && isspace((unsigned char)line[strlen(CONF_MMAP)]))
+				a.mmap = parse_config_boolean(CONF_MMAP, line, a.mmap);
 end_line:
 			free(line);
 			line = NULL;
@@ -198,17 +301,35 @@ end_line:
 			{ "key",            required_argument, 0, 'k' },
 			{ "password",       required_argument, 0, 'p' },
 			{ "no-compress",    no_argument,       0, 'x' },
+			{ "compressor",     required_argument, 0, 'z' },
+			{ "compress-level", required_argument, 0, 'L' },
+			{ "ecc",            required_argument, 0, 'e' },
 			{ "back-compat",    required_argument, 0, 'b' },
 			{ "follow",         no_argument,       0, 'f' },
 			{ "raw",            no_argument,       0, 'r' },
 			{ "nocli",          no_argument,       0, 'u' },
+			{ "io-buffer",      required_argument, 0, 'B' },
+			{ "threads",        required_argument, 0, 't' },
+			{ "xz-block",       required_argument, 0, 'X' },
+			{ "xz-memlimit",    required_argument, 0, 'M' },
+			{ "pipeline",       no_argument,       0, 'P' },
+			{ "io-uring",       no_argument,       0, 'U' },
+			{ "drop-cache",     no_argument,       0, 'C' },
+			{ "direct",         no_argument,       0, 'D' },
+			{ "mmap",           no_argument,       0, 'O' },
+			{ "range",          required_argument, 0, 'R' },
+			{ "list",           no_argument,       0, 'T' },
+			{ "extract",        required_argument, 0, 'E' },
+			{ "look-ahead",     required_argument, 0, 'W' },
+			{ "write-behind",   required_argument, 0, 'w' },
+			{ "scrub",          no_argument,       0, 'S' },
 			{ NULL,             0,                 0,  0  }
 		};
 
 		while (true)
 		{
 			int index = 0;
-			int c = getopt_long(argc, argv, "hvlgc:s:m:a:i:k:p:xb:fru", options, &index);
+			int c = getopt_long(argc, argv, "hvlgc:s:m:a:i:k:p:xz:L:e:b:fruB:t:X:M:PUCDOR:TE:W:w:S", options, &index);
 			if (c == -1)
 				break;
 			switch (c)
@@ -260,6 +381,17 @@ end_line:
 					 */
 					a.compress = false;
 					break;
+				case 'z':
+					free(a.compressor);
+					a.compressor = strdup(optarg);
+					break;
+				case 'L':
+					a.compress_level = strtol(optarg, NULL, 0);
+					break;
+				case 'e':
+					free(a.ecc);
+					a.ecc = strdup(optarg);
+					break;
 				case 'b':
 					free(a.version);
 					a.version = strdup(optarg);
@@ -273,6 +405,57 @@ end_line:
 				case 'u':
 					a.cli = false;
 					break;
+				case 'B':
+					a.io_buffer = strtoull(optarg, NULL, 0);
+					break;
+				case 't':
+					a.threads = strtoul(optarg, NULL, 0);
+					break;
+				case 'X':
+					a.xz_block = strtoull(optarg, NULL, 0);
+					break;
+				case 'M':
+					a.xz_memlimit = strtoull(optarg, NULL, 0);
+					break;
+				case 'P':
+					a.pipeline = true;
+					break;
+				case 'U':
+					a.io_uring = true;
+					break;
+				case 'C':
+					a.drop_cache = true;
+					break;
+				case 'D':
+					a.direct = true;
+					break;
+				case 'O':
+					a.mmap = true;
+					break;
+				case 'R':
+					{
+						char *e = NULL;
+						a.range_offset = strtoull(optarg, &e, 0);
+						a.range_length = *e == ':' ? strtoull(e + 1, NULL, 0) : 0;
+						a.range = true;
+					}
+					break;
+				case 'T':
+					a.list = true;
+					break;
+				case 'E':
+					free(a.extract);
+					a.extract = strdup(optarg);
+					break;
+				case 'W':
+					a.look_ahead = strtoull(optarg, NULL, 0);
+					break;
+				case 'w':
+					a.write_behind = strtoull(optarg, NULL, 0);
+					break;
+				case 'S':
+					a.scrub = true;
+					break;
 				case '?':
 				default:
 					show_usage();
@@ -303,6 +486,10 @@ extern void init_deinit(args_t args)
 		free(args.mode);
 	if (args.mac)
 		free(args.mac);
+	if (args.compressor)
+		free(args.compressor);
+	if (args.ecc)
+		free(args.ecc);
 	if (args.key)
 		free(args.key);
 	if (args.password)
@@ -313,6 +500,8 @@ extern void init_deinit(args_t args)
 		free(args.output);
 	if (args.version)
 		free(args.version);
+	if (args.extract)
+		free(args.extract);
 	return;
 }
 
@@ -506,14 +695,34 @@ extern void show_help(void)
 	format_help_line('p', "password",    "password",  _("Password used to generate the key"));
 	if (is_encrypt())
 	{
-		format_help_line('x', "no-compress", NULL,        _("Do not compress the plain text using the xz algorithm"));
+		format_help_line('x', "no-compress", NULL,        _("Do not compress the plain text"));
+		format_help_line('z', "compressor",  "algorithm", _("Compression algorithm to use: xz (default), zstd or lz4"));
+		format_help_line('L', "compress-level", "level",  _("Compression level; the default depends on the algorithm"));
 		format_help_line('f', "follow",      NULL,        _("Follow symlinks, the default is to store the link itself"));
 		format_section(_("Advnaced Options"));
 		format_help_line('b', "back-compat", "version",   _("Create an encrypted file that is backwards compatible"));
+		format_help_line('X', "xz-block",    "MiB",       _("Size of each independently compressed block when using threads"));
+		format_help_line('W', "look-ahead",  "MiB",       _("Read (and compress) the files in a directory ahead of time"));
+		format_help_line('e', "ecc",         "profile",   _("Error correction to use: rs (default), interleaved (for bursts of errors) or off"));
 	}
 	else
+	{
 		format_section(_("Advnaced Options"));
+		format_help_line('M', "xz-memlimit", "MiB",       _("Limit the memory used when decompressing with threads"));
+		format_help_line('R', "range",       "start:len", _("Decrypt only part of an (uncompressed) file"));
+		format_help_line('T', "list",        NULL,        _("List the contents of a directory"));
+		format_help_line('E', "extract",     "path",      _("Decrypt only the given file (or link) from a directory"));
+		format_help_line('w', "write-behind", "MiB",      _("Write the files in a directory on separate threads"));
+		format_help_line('S', "scrub",       NULL,        _("Check, and correct, the error correction only (no key is needed); the output is a repaired copy, without it the source is repaired in place"));
+	}
+	format_help_line('t', "threads",     "threads",   _("Number of threads to use for (de)compression, (en/de)cryption and error correction; 0 for one per CPU core"));
 	format_help_line('r', "raw",         NULL,        _("Don’t generate or look for an encrypt header; this IS NOT recommended, but can be useful in some (limited) situations"));
+	format_help_line('B', "io-buffer",   "MiB",       _("Size of the buffer used to batch reads and writes"));
+	format_help_line('P', "pipeline",    NULL,        _("Read, write and correct errors on separate threads"));
+	format_help_line('U', "io-uring",    NULL,        _("Keep several reads/writes in flight using io_uring (if available)"));
+	format_help_line('C', "drop-cache",  NULL,        _("Keep files out of the page cache; for very large jobs"));
+	format_help_line('D', "direct",      NULL,        _("Bypass the page cache entirely (O_DIRECT); implies --drop-cache"));
+	format_help_line('O', "mmap",        NULL,        _("Read files through a memory mapping instead of copying them"));
 	format_section(_("Notes"));
 	fprintf(stderr, _("  • If you do not supply a key or password, you will be prompted for one.\n"));
 	if (is_encrypt())
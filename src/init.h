@@ -24,12 +24,15 @@
 #define APP_NAME "encrypt"
 #define ALT_NAME "decrypt"
 
-#define APP_USAGE "[source] [destination] [-c algorithm] [-s algorithm] [-m mode]\n           [-i iterations] [-k key/-p password] [-x] [-f] [-g] [-b version]"
-#define ALT_USAGE "[-k key/-p password] [input] [output]"
+#define APP_USAGE "[source] [destination] [-c algorithm] [-s algorithm] [-m mode]\n           [-i iterations] [-k key/-p password] [-x] [-f] [-g] [-b version]\n           [-B size] [-t threads] [-X size] [-z algorithm] [-L level]\n           [-P] [-U] [-C] [-D] [-O] [-W size] [-e profile]"
+#define ALT_USAGE "[-k key/-p password] [-B size] [-t threads] [-M size] [-P] [-U] [-C] [-D] [-O]\n           [-R start:length] [-T] [-E path] [-w size] [-S] [input] [output]"
 
 #define ENCRYPTRC ".encryptrc"
 
 #define CONF_COMPRESS       "compress"
+#define CONF_COMPRESSOR     "compressor"
+#define CONF_COMPRESS_LEVEL "compress-level"
+#define CONF_ECC            "ecc"
 #define CONF_FOLLOW         "follow"
 #define CONF_KDF_ITERATIONS "kdf-iterations"
 #define CONF_KEY            "key"
@@ -39,6 +42,17 @@
 #define CONF_MAC            "mac"
 #define CONF_VERSION        "version"
 #define CONF_SKIP_HEADER    "raw"
+#define CONF_IO_BUFFER      "io-buffer"
+#define CONF_THREADS        "threads"
+#define CONF_XZ_BLOCK       "xz-block"
+#define CONF_XZ_MEMLIMIT    "xz-memlimit"
+#define CONF_PIPELINE       "pipeline"
+#define CONF_IO_URING       "io-uring"
+#define CONF_DROP_CACHE     "drop-cache"
+#define CONF_DIRECT         "direct"
+#define CONF_MMAP           "mmap"
+#define CONF_LOOK_AHEAD     "look-ahead"
+#define CONF_WRITE_BEHIND   "write-behind"
 
 #define CONF_TRUE     "true"
 #define CONF_ON       "on"
@@ -73,18 +87,38 @@ typedef struct
 	char *hash;              /*!< The hash function selected by the user */
 	char *mode;              /*!< The encryption mode selected by the user */
 	char *mac;               /*!< The MAC selected by the user */
+	char *compressor;        /*!< The compression algorithm selected by the user */
+	char *ecc;               /*!< The error correction profile selected by the user */
+	int compress_level;      /*!< The compression level; -1 for the algorithm’s default */
 	uint64_t kdf_iterations; /*!< The number of iterations for the kdf */
+	uint64_t io_buffer;      /*!< Size of the IO staging buffer (in MiB) */
+	uint32_t threads;        /*!< Number of (de)compression threads (0 for one per core) */
+	uint64_t xz_block;       /*!< Size of each xz block when compressing with threads (in MiB) */
+	uint64_t xz_memlimit;    /*!< Memory limit when decompressing with threads (in MiB) */
+	uint64_t look_ahead;     /*!< How much of the files in a directory to read ahead of time (in MiB) */
+	uint64_t write_behind;   /*!< How much of the files in a directory to hold while they’re written (in MiB) */
+	uint64_t range_offset;   /*!< Where to start decrypting */
+	uint64_t range_length;   /*!< How much to decrypt (0 for the rest) */
 	char *key;               /*!< The key file for key generation */
 	char *password;          /*!< The password for key generation */
 	char *source;            /*!< The input file/stream */
 	char *output;            /*!< The output file/stream */
 	char *version;           /*!< The container version to use */
+	char *extract;           /*!< The only file to decrypt from a directory */
 	key_source_e key_source; /*!< The expected key source (GUI only) */
 	bool compress:1;         /*!< Compress the file (with xz) before encrypting */
 	bool follow:1;           /*!< Follow symlinks or not */
 	bool gui:1;              /*!< Whether or not to display the GUI (if available) */
 	bool cli:1;              /*!< Whether or not to display the CLI progress bar */
 	bool raw:1;              /*!< Whether the header should be skipped */
+	bool pipeline:1;         /*!< Whether to run the IO layers on their own threads */
+	bool io_uring:1;         /*!< Whether to read/write files using io_uring */
+	bool drop_cache:1;       /*!< Whether to keep files out of the page cache */
+	bool direct:1;           /*!< Whether to open files with O_DIRECT */
+	bool mmap:1;             /*!< Whether to read files through a memory mapping */
+	bool range:1;            /*!< Whether to decrypt only part of a file */
+	bool list:1;             /*!< Whether to list what’s in a directory */
+	bool scrub:1;            /*!< Whether to check (and repair) the error correction instead */
 }
 args_t;
 
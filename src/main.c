@@ -28,6 +28,7 @@
 
 #include <string.h>
 #include <stdbool.h>
+#include <inttypes.h>
 
 #include <sys/stat.h>
 
@@ -68,6 +69,8 @@ static bool list_ciphers(void);
 static bool list_hashes(void);
 static bool list_modes(void);
 static bool list_macs(void);
+static bool list_compressors(void);
+static bool scrub(const char *, const char *);
 
 int main(int argc, char **argv)
 {
@@ -81,6 +84,15 @@ int main(int argc, char **argv)
 #endif
 	args_t args = init(argc, argv);
 
+	io_set_buffer_size(args.io_buffer * MEGABYTE);
+	io_set_compression_threads(args.threads, args.xz_block * MEGABYTE);
+	io_set_decompression_threads(args.threads, args.xz_memlimit * MEGABYTE);
+	io_set_encryption_threads(args.threads);
+	io_set_pipeline(args.pipeline);
+	io_set_uring(args.io_uring);
+	io_set_cache(args.drop_cache, args.direct);
+	io_set_mmap(args.mmap);
+
 	/*
 	 * list available algorithms if asked to (possibly both hash and
 	 * crypto)
@@ -94,9 +106,49 @@ int main(int argc, char **argv)
 		la = list_modes();
 	if (args.mac && !strcasecmp(args.mac, "list"))
 		la = list_macs();
+	if (args.compressor && !strcasecmp(args.compressor, "list"))
+		la = list_compressors();
 	if (la)
 		return EXIT_SUCCESS;
 
+	io_compressor_e z = io_compressor_from_name(args.compressor);
+	if (z == IO_COMPRESSOR_UNKNOWN)
+	{
+		cli_fprintf(stderr, ANSI_COLOUR_RED "%s (%s)" ANSI_COLOUR_RESET "\n", _("Failed: Unsupported compression algorithm!"), args.compressor);
+		init_deinit(args);
+		return EXIT_FAILURE;
+	}
+	io_set_compressor(z, args.compress_level);
+
+	io_correction_e ecc = io_correction_from_name(args.ecc);
+	if (ecc == IO_CORRECTION_UNKNOWN)
+	{
+		cli_fprintf(stderr, ANSI_COLOUR_RED "%s (%s)" ANSI_COLOUR_RESET "\n", _("Failed: Unknown error correction profile!"), args.ecc);
+		init_deinit(args);
+		return EXIT_FAILURE;
+	}
+	/*
+	 * before 2026.11 there was only the one way of correcting errors
+	 * (if any), so asking for another can’t be done
+	 */
+	if (ecc != IO_CORRECTION_RS && parse_version(args.version) < VERSION_2026_11)
+	{
+		cli_fprintf(stderr, ANSI_COLOUR_RED "%s (%s)" ANSI_COLOUR_RESET "\n", _("Failed: Error correction profile unavailable before version 2026.11!"), args.ecc);
+		init_deinit(args);
+		return EXIT_FAILURE;
+	}
+	io_set_correction(ecc);
+
+	/*
+	 * scrubbing doesn’t need a key, so there’s no need to ask for one
+	 */
+	if (args.scrub)
+	{
+		bool s = scrub(args.source, args.output);
+		init_deinit(args);
+		return s ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 #if !defined _WIN32
 	bool dude = false;
 	if (!strcmp(basename(argv[0]), ALT_NAME))
@@ -310,9 +362,22 @@ int main(int argc, char **argv)
 	crypto_t *c;
 
 	if (dude || (args.source && is_encrypted(args.source)))
+	{
 		c = decrypt_init(args.source, args.output, args.cipher, args.hash, args.mode, args.mac, key, length, args.kdf_iterations, args.raw);
+		c->range = args.range;
+		c->range_offset = args.range_offset;
+		c->range_length = args.range_length;
+		c->list = args.list;
+		c->extract = args.extract ? strdup(args.extract) : NULL;
+		c->write_behind = args.write_behind * MEGABYTE;
+		c->workers = args.threads;
+	}
 	else
+	{
 		c = encrypt_init(args.source, args.output, args.cipher, args.hash, args.mode, args.mac, key, length, args.kdf_iterations, args.raw, args.compress, args.follow, parse_version(args.version));
+		c->look_ahead = args.look_ahead * MEGABYTE;
+		c->workers = args.threads;
+	}
 
 	init_deinit(args);
 
@@ -389,3 +454,81 @@ static bool list_macs(void)
 		fprintf(stderr, "%s\n", l[i]);
 	return true;
 }
+
+static bool list_compressors(void)
+{
+	const char **l = io_list_of_compressors();
+	for (int i = 0; l[i]; i++)
+		fprintf(stderr, "%s\n", l[i]);
+	return true;
+}
+
+/*
+ * check, and correct, the error correction of an encrypted file, a
+ * region at a time; only regions with errors are reported, then the
+ * totals for the whole file
+ */
+static bool scrub(const char *i, const char *o)
+{
+	init_crypto();
+
+	if (!i)
+		return cli_fprintf(stderr, ANSI_COLOUR_RED "%s" ANSI_COLOUR_RESET "\n", _("Failed: Cannot scrub stdin!")) , false;
+	if (is_encrypted(i) < VERSION_2015_10)
+		return cli_fprintf(stderr, ANSI_COLOUR_RED "%s (%s)" ANSI_COLOUR_RESET "\n", _("Failed: No error correction to check!"), i) , false;
+	IO_HANDLE in = io_open(i, (o ? O_RDONLY : O_RDWR) | O_BINARY, S_IRUSR | S_IWUSR);
+	IO_HANDLE out = NULL;
+	if (!in || (o && !(out = io_open(o, O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, S_IRUSR | S_IWUSR))))
+	{
+		cli_fprintf(stderr, ANSI_COLOUR_RED "%s (%s)" ANSI_COLOUR_RESET "\n", _("Failed: Read/Write error!"), strerror(errno));
+		if (in)
+			io_close(in);
+		return false;
+	}
+	/*
+	 * the header comes before the error correction, so is copied as it is
+	 */
+	uint64_t head[3] = { 0x0 };
+	int e = io_read(in, head, sizeof head) == sizeof head && (!out || io_write(out, head, sizeof head) == sizeof head) ? 1 : -1;
+	/*
+	 * as is the profile (since 2026.11), which may be to have none
+	 */
+	version_e v = check_version(ntohll(head[2]));
+	io_correction_e p = IO_CORRECTION_UNKNOWN;
+	if (e > 0)
+	{
+		uint8_t b = p = correction_init(in, v);
+		if (v >= VERSION_2026_11 && out && io_write(out, &b, sizeof b) != sizeof b)
+			e = -1;
+	}
+	if (e > 0 && (p == IO_CORRECTION_OFF || p == IO_CORRECTION_UNKNOWN))
+	{
+		if (out)
+			io_close(out);
+		io_close(in);
+		return cli_fprintf(stderr, ANSI_COLOUR_RED "%s (%s)" ANSI_COLOUR_RESET "\n", _("Failed: No error correction to check!"), i) , false;
+	}
+
+	uint64_t n = 0;
+	uint64_t c = 0;
+	uint64_t f = 0;
+	io_scrub_t r;
+	while (e > 0 && (e = io_scrub(in, out, &r)) > 0)
+	{
+		n += r.codewords;
+		c += r.corrected;
+		f += r.failed;
+		if (r.corrected || r.failed)
+			printf(_("%#012jx-%#012jx: %u codewords, %u corrected, %u uncorrectable\n"), (uintmax_t)r.offset, (uintmax_t)(r.offset + r.length), r.codewords, r.corrected, r.failed);
+	}
+	if (e < 0)
+		cli_fprintf(stderr, ANSI_COLOUR_RED "%s (%s)" ANSI_COLOUR_RESET "\n", _("Failed: Read/Write error!"), strerror(errno));
+	if (out && io_close(out) < 0 && !e)
+		e = -1 , cli_fprintf(stderr, ANSI_COLOUR_RED "%s (%s)" ANSI_COLOUR_RESET "\n", _("Failed: Read/Write error!"), strerror(errno));
+	io_close(in);
+
+	printf(_("%s: %" PRIu64 " codewords, %" PRIu64 " corrected, %" PRIu64 " uncorrectable\n"), i, n, c, f);
+	if (f)
+		cli_fprintf(stderr, ANSI_COLOUR_RED "%s" ANSI_COLOUR_RESET "\n", _("Failed: Uncorrectable errors! (Data is damaged)"));
+	return !e && !f;
+}